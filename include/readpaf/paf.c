@@ -1,17 +1,16 @@
-#include <zlib.h>
 #include <stdio.h>
 #include <string.h>
 #include "paf.h"
+#include "input.h"
 
 #include "kseq.h"
-KSTREAM_INIT(gzFile, gzread, 0x10000)
-#define _POSIX_C_SOURCE 1
+KSTREAM_INIT(in_file_t*, in_read, 0x10000)
 paf_file_t *paf_open(const char *fn)
 {
     kstream_t *ks;
-    gzFile fp;
+    in_file_t *fp;
     paf_file_t *pf;
-    fp = fn && strcmp(fn, "-")? gzopen(fn, "r") : gzdopen(fileno(stdin), "r");
+    fp = in_open(fn, 1);
     if (fp == 0) return 0;
     ks = ks_init(fp);
     pf = (paf_file_t*)calloc(1, sizeof(paf_file_t));
@@ -25,7 +24,7 @@ int paf_close(paf_file_t *pf)
     if (pf == 0) return 0;
     free(pf->buf.s);
     ks = (kstream_t*)pf->fp;
-    gzclose(ks->f);
+    in_close(ks->f);
     ks_destroy(ks);
     free(pf);
     return 0;
@@ -32,6 +32,7 @@ extern "C" {
 paf_file_t *paf_open(const char *fn);
 int paf_close(paf_file_t *pf);
 int paf_read(paf_file_t *pf, paf_rec_t *r);
+int paf_parse(int l, char *s, paf_rec_t *pr);
 
 #ifdef __cplusplus
 }
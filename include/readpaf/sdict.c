@@ -1,3 +1,4 @@
+#define _POSIX_C_SOURCE 200809L // strdup
 #include <string.h>
 #include "sdict.h"
 
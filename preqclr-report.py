@@ -211,7 +211,9 @@ def create_report(output_prefix, preqclr_file, plots_requested):
             # check if ngx calculated
             if 'ngx_values' in data.keys():
                 ngx_calculated=True
-                ngx_values[s] = (color, data['ngx_values'], marker)
+                # the LGX values, auNG and the curves against other genome
+                # sizes are only in files from newer versions
+                ngx_values[s] = (color, data['ngx_values'], marker, data.get('lgx_values', {}), data.get('aung'), data.get('ngx_references', []))
             # check if DUST score calculated
             if 'dust_scores' in data.keys():
                 dust_calculated=True
@@ -441,9 +443,16 @@ def plot_read_length_distribution(ax, data, output_prefix):
         s_color = read_lengths[s][0]
         sd = read_lengths[s][1]
 
-        base = 100
-        sd_rounded = [ int(base * round(float(x)/base)) for x in sd ]
-        labels, values = zip(*sorted(collections.Counter(sorted(sd_rounded)).items()))
+        if is_summary(sd):
+            labels, values = summary_points(sd)
+            s_max_read_length = sd['max']
+            s_x_lim = summary_quantile(sd, float(max_percentile)/100.0)
+        else:
+            base = 100
+            sd_rounded = [ int(base * round(float(x)/base)) for x in sd ]
+            labels, values = zip(*sorted(collections.Counter(sorted(sd_rounded)).items()))
+            s_max_read_length = max(sd_rounded)
+            s_x_lim = np.percentile(sd_rounded, max_percentile)
 
         # normalize labels
         s = sum(values)
@@ -456,10 +465,9 @@ def plot_read_length_distribution(ax, data, output_prefix):
         # get x and y limits
         if max(nvalues) > y_lim:
             y_lim = max(nvalues)*1.3
-        s_max_read_length = max(sd_rounded)
         if s_max_read_length > max_read_length:
             max_read_length = s_max_read_length
-            x_lim = np.percentile(sd_rounded, max_percentile)
+            x_lim = s_x_lim
 
         # plot!
         ax.plot(labels, [float(i) for i in nvalues], color=s_color, label=s_name)
@@ -487,12 +495,14 @@ def plot_est_cov(ax, data, filter_info, peak_cov, output_prefix):
         sd = data[s] # list of tuples (read_cov, read_len)
         sd_upperbound_cov = filter_info[s][1]
         sd_est_cov_read_length = data[s][1] # this returns a dictionary with key = est_cov and value
-        sd_est_cov = [ round(float(x)) for x in sd_est_cov_read_length.keys() ]
         sd_mode_cov = peak_cov[s]
         s_name = s
         s_color = data[s][0]
-        d = sorted(sd_est_cov)
-        x, y = zip(*sorted(collections.Counter(sorted(sd_est_cov)).items()))
+        if is_summary(sd_est_cov_read_length):
+            x, y = summary_points(sd_est_cov_read_length)
+        else:
+            sd_est_cov = [ round(float(x)) for x in sd_est_cov_read_length.keys() ]
+            x, y = zip(*sorted(collections.Counter(sorted(sd_est_cov)).items()))
 
         # normalize y values and identify x limit
         sy = sum(y)
@@ -536,12 +546,15 @@ def plot_per_read_GC_content(ax, data, output_prefix):
         per_read_GC_content = {}
         s_name = s
         s_color = data[s][0]
-        sd = list()
-        for i in data[s][1]:
-            if i != 0:
-                sd.append(round(float(i),0))
-        # reading json data from preqc-lr v2.0
-        x, y = zip(*sorted(collections.Counter(sorted(sd)).items()))
+        if is_summary(data[s][1]):
+            x, y = summary_points(data[s][1])
+        else:
+            sd = list()
+            for i in data[s][1]:
+                if i != 0:
+                    sd.append(round(float(i),0))
+            # reading json data from preqc-lr v2.0
+            x, y = zip(*sorted(collections.Counter(sorted(sd)).items()))
         
         # normalize yvalues
         sy = sum(y)
@@ -681,29 +694,54 @@ def plot_total_num_bases_vs_min_read_length(ax, data, s, output_prefix):
     ax.set_xlim(0, x_lim)
     return ax
 
+def ngx_points(sd):
+    # keys are X, written as "50" or "12.5"
+    lists = list()
+    for key in sd:
+        lists.append((float(key), sd[key]))
+    lists.sort(key=lambda x: x[0])
+    return zip(*lists)
+
 def plot_ngx(ax, data, output_prefix):
     # ========================================================
     custom_print( "[ Plotting NGX values ]" )
     ax.set_title('NG(X)')
     # ========================================================
 
+    # LGX on a second axis, dotted
+    ax_lgx = None
     for s in data:
         s_name = s
         s_color = data[s][0]
         sd = data[s][1]
         s_marker = data[s][2]
-        lists = list()
-        for key in sd:
-            lists.append((int(key), sd[key]))
-        lists.sort(key=lambda x: x[0])
-        x, y = zip(*lists)
-        ax.plot(x, y, label=s_name, color=s_color)
+        lgx = data[s][3]
+        aung = data[s][4]
+        label = s_name
+        if aung is not None:
+            label += ' (auNG ' + str(int(aung)) + ')'
+        if sd:
+            x, y = ngx_points(sd)
+            ax.plot(x, y, label=label, color=s_color)
+        if lgx:
+            if ax_lgx is None:
+                ax_lgx = ax.twinx()
+                ax_lgx.set_ylabel('LG(X), number of contigs', fontsize=6)
+            x, y = ngx_points(lgx)
+            ax_lgx.plot(x, y, color=s_color, linestyle=':')
+
+        # the same curves against each genome size given with --genome-size, dashed
+        for r in data[s][5]:
+            if r['ngx_values']:
+                x, y = ngx_points(r['ngx_values'])
+                ax.plot(x, y, label=s_name + ' (G=' + str(int(r['genome_size'])) + ')', color=s_color, linestyle='--')
 
     # configure subplot
     ax.grid(True, linestyle='-', linewidth=0.3)
     ax.set_xlabel('X (%)')
     ax.set_ylabel('Contig length (Mbps)')
     ax.set_xlim(0,100)
+    ax.legend(loc='upper right', fontsize=5)
     return ax
 
 def plot_indel_error_rates(ax, data, output_prefix):
@@ -713,11 +751,14 @@ def plot_indel_error_rates(ax, data, output_prefix):
     for s in data:
         s_name = s
         s_color = data[s][0]
-        sd = list()
-        for i in data[s][1]:
-            if i != 0:
-                sd.append(round(i,3))
-        x, y = zip(*sorted(collections.Counter(sorted(sd)).items()))
+        if is_summary(data[s][1]):
+            x, y = summary_points(data[s][1])
+        else:
+            sd = list()
+            for i in data[s][1]:
+                if i != 0:
+                    sd.append(round(i,3))
+            x, y = zip(*sorted(collections.Counter(sorted(sd)).items()))
 
         # normalize yvalues
         sy = sum(y)
@@ -748,11 +789,14 @@ def plot_overlap_lengths(ax, data, output_prefix):
     for s in data:
         s_name = s
         s_color = data[s][0]
-        sd = list()
-        for i in data[s][1]:
-            if i != 0:
-                sd.append(int(math.ceil(i / 10.0)) * 10)
-        x, y = zip(*sorted(collections.Counter(sorted(sd)).items()))
+        if is_summary(data[s][1]):
+            x, y = summary_points(data[s][1])
+        else:
+            sd = list()
+            for i in data[s][1]:
+                if i != 0:
+                    sd.append(int(math.ceil(i / 10.0)) * 10)
+            x, y = zip(*sorted(collections.Counter(sorted(sd)).items()))
 
         # normalize yvalues
         sy = sum(y)
@@ -784,11 +828,14 @@ def plot_dust_scores(ax, data, output_prefix):
         per_read_DUST_score = {}
         s_name = s
         s_color = data[s][0]
-        sd = list()
-        for i in data[s][1]:
-            if i != 0:
-                sd.append(float(i))
-        x, y = zip(*sorted(collections.Counter(sorted(sd)).items()))
+        if is_summary(data[s][1]):
+            x, y = summary_points(data[s][1])
+        else:
+            sd = list()
+            for i in data[s][1]:
+                if i != 0:
+                    sd.append(float(i))
+            x, y = zip(*sorted(collections.Counter(sorted(sd)).items()))
 
         # normalize yvalues
         sy = sum(y)
@@ -813,6 +860,44 @@ def plot_dust_scores(ax, data, output_prefix):
     return ax
 
 
+def is_summary(d):
+    # distributions written by preqclr calculate --summary are objects
+    # holding a histogram and a quantile sketch instead of every value
+    return isinstance(d, dict) and 'histogram' in d
+
+def summary_points(d):
+    # centres and counts of the non-empty bins of a summarised distribution
+    # zeros are counted on their own and left out, as in the per-value plots
+    h = d['histogram']
+    x = list()
+    y = list()
+    for i, c in enumerate(h['counts']):
+        if c == 0:
+            continue
+        lo = (h['offset'] + i) * h['width']
+        hi = lo + h['width']
+        if h['scale'] == 'log':
+            lo = 10 ** lo
+            hi = 10 ** hi
+        x.append((lo + hi) / 2.0)
+        y.append(c)
+    return x, y
+
+def summary_quantile(d, q):
+    # value at quantile q, within the relative accuracy alpha of the sketch
+    sk = d['sketch']
+    gamma = (1.0 + sk['alpha']) / (1.0 - sk['alpha'])
+    n = sk['zeros'] + sum(sk['counts'])
+    rank = q * (n - 1)
+    seen = sk['zeros']
+    if rank < seen:
+        return 0.0
+    for i, c in enumerate(sk['counts']):
+        seen += c
+        if rank < seen:
+            return 2 * gamma ** (sk['offset'] + i) / (gamma + 1)
+    return 2 * gamma ** (sk['offset'] + len(sk['counts']) - 1) / (gamma + 1)
+
 def custom_print(s):
     global verbose
     global log
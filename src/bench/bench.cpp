@@ -0,0 +1,566 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr bench -- micro- and macro-benchmarks on synthetic data
+// results are written to stdout as JSON
+//
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench.hpp"
+#include "contig.hpp"
+#include "cov_stats.hpp"
+#include "dust.hpp"
+#include "fq_reader.hpp"
+#include "ngx.hpp"
+#include "overlap_engine.hpp"
+#include "paf_reader.hpp"
+#include "read_table.hpp"
+#include "seq_stats.hpp"
+#include "summary.hpp"
+#include "readpaf/paf.h"
+
+using namespace std;
+
+namespace opt
+{
+    static string dir = "bench_data";
+    static string preqclr;
+    static unsigned int threads = max(1u, thread::hardware_concurrency());
+    static synth_config synth = default_synth_config();
+}
+
+static uint64_t file_size(const string& fn)
+{
+    struct stat st;
+    return stat(fn.c_str(), &st) == 0 ? st.st_size : 0;
+}
+
+static uint64_t count_lines(const string& fn)
+{
+    uint64_t n = 0;
+    ifstream in(fn);
+    string line;
+    while ( getline(in, line) ) {
+        n++;
+    }
+    return n;
+}
+
+static long peak_rss_kb(int who)
+{
+    struct rusage ru;
+    getrusage(who, &ru);
+    return ru.ru_maxrss;
+}
+
+// a field of /proc/self/status in kB, -1 if it cannot be read
+static long status_kb(const string& field)
+{
+    ifstream in("/proc/self/status");
+    string line;
+    while ( getline(in, line) ) {
+        if ( line.compare(0, field.size() + 1, field + ":") == 0 ) {
+            return atol(line.c_str() + field.size() + 1);
+        }
+    }
+    return -1;
+}
+
+// sets the peak RSS of the process back to its current RSS
+static bool reset_peak_rss()
+{
+    FILE* fp = fopen("/proc/self/clear_refs", "w");
+    if ( fp == NULL ) {
+        return false;
+    }
+    bool ok = fputs("5", fp) >= 0;
+    return fclose(fp) == 0 && ok;
+}
+
+int main(int argc, char *argv[])
+{
+    parse_args(argc, argv);
+    if ( mkdir(opt::dir.c_str(), 0755) != 0 && errno != EEXIST ) {
+        fprintf(stderr, "ERROR: failed to create %s.\n\n", opt::dir.c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    // fixtures, the same for the same settings; they are made by a child
+    // process, so the memory used to make them is not in the peak RSS
+    string fq = opt::dir + "/reads.fq";
+    string paf = opt::dir + "/overlaps.paf";
+    string gfa = opt::dir + "/layout.gfa";
+    // the alignments of the reads to the contigs, passed with --bam
+    string bam = opt::dir + "/reads-to-contigs.bam";
+    pid_t pid = fork();
+    if ( pid == 0 ) {
+        synth s(opt::synth);
+        s.write_fastq(fq);
+        s.write_paf(paf);
+        s.write_gfa(gfa);
+        s.write_bam(bam);
+        _exit(0);
+    }
+    int status = 0;
+    if ( pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0 ) {
+        fprintf(stderr, "ERROR: failed to write the synthetic files to %s.\n\n", opt::dir.c_str());
+        exit(EXIT_FAILURE);
+    }
+    bench_work paf_work = { count_lines(paf), file_size(paf) };
+    bench_work fq_work = { count_lines(fq) / 4, file_size(fq) };
+    vector<bench_result> results;
+
+    // whole runs, with the time of each calculate_* stage; they go first, while
+    // this process is small, as a child starts with the pages of its parent
+    vector<bench_result> runs;
+    if ( !opt::preqclr.empty() ) {
+        bench_work work = { paf_work.records + fq_work.records, paf_work.bytes + fq_work.bytes };
+        // the sample name goes first, it names the log of the run
+        auto preqclr_args = [](const string& name, unsigned int t) {
+            return vector<string>{ opt::preqclr, "-n", name, "-r", "reads.fq", "-p", "overlaps.paf", "-t", to_string(t) };
+        };
+        for ( unsigned int t : { 1u, opt::threads } ) {
+            runs.push_back(run_macro("preqclr_t" + to_string(t), preqclr_args("bench_t" + to_string(t), t), work));
+        }
+        vector<string> args = preqclr_args("bench_summary", opt::threads);
+        args.push_back("--summary");
+        runs.push_back(run_macro("preqclr_summary", args, work));
+        args = preqclr_args("bench_gfa", opt::threads);
+        args.insert(args.end(), { "-g", "layout.gfa", "--bam=reads-to-contigs.bam" });
+        runs.push_back(run_macro("preqclr_gfa", args, work));
+    }
+
+    // reading and parsing
+    results.push_back(run_micro("paf_read", [&]() {
+        // line by line parser of readpaf
+        paf_file_t* pf = paf_open(paf.c_str());
+        paf_rec_t r;
+        uint64_t n = 0;
+        while ( paf_read(pf, &r) >= 0 ) {
+            n++;
+        }
+        paf_close(pf);
+        return bench_work{ n, paf_work.bytes };
+    }));
+    for ( unsigned int t : { 1u, opt::threads } ) {
+        results.push_back(run_micro("paf_parse_t" + to_string(t), [&]() {
+            paf_reader reader(paf, t, [](const paf_record&) { return 0; });
+            uint64_t n = 0;
+            paf_chunk* c;
+            while ( (c = reader.next()) != NULL ) {
+                n += c->records.size();
+                reader.release(c);
+            }
+            return bench_work{ n, paf_work.bytes };
+        }));
+    }
+    // overlaps and read ids for the overlap benchmarks, not timed
+    vector<paf_record> records;
+    vector<pair<uint32_t, uint32_t>> ids;
+    read_table names;
+    {
+        paf_reader reader(paf, opt::threads, [](const paf_record&) { return 0; });
+        paf_chunk* c;
+        while ( (c = reader.next()) != NULL ) {
+            for ( auto const& r : c->records ) {
+                ids.push_back(make_pair(names.intern(r.qn.s, r.qn.l), names.intern(r.tn.s, r.tn.l)));
+                records.push_back(r);
+                records.back().qn.s = records.back().tn.s = NULL;
+            }
+            reader.release(c);
+        }
+    }
+    vector<string> seqs;
+    results.push_back(run_micro("fq_read", [&]() {
+        fq_reader reader(fq, 1, [](fq_batch*) {}, 0, 0);
+        uint64_t n = 0;
+        while ( fq_batch* b = reader.next() ) {
+            for ( size_t i = 0; i < b->size(); i++ ) {
+                seqs.push_back(string(b->seq(i), b->len(i)));
+            }
+            n += b->size();
+            reader.release(b);
+        }
+        return bench_work{ n, fq_work.bytes };
+    }));
+
+    // per-read kernels
+    uint64_t n_bases = 0;
+    for ( auto const& q : seqs ) {
+        n_bases += q.size();
+    }
+    results.push_back(run_micro("count_gc", [&]() {
+        size_t gc = 0;
+        for ( auto const& q : seqs ) {
+            gc += count_gc(q.data(), q.size());
+        }
+        return bench_work{ gc > 0 ? seqs.size() : 0, n_bases };
+    }));
+    results.push_back(run_micro("dust_score", [&]() {
+        double d = 0;
+        for ( auto const& q : seqs ) {
+            d += dust_score(q.data(), q.size());
+        }
+        return bench_work{ d >= 0 ? seqs.size() : 0, n_bases };
+    }));
+    results.push_back(run_micro("dust_low_complexity", [&]() {
+        double d = 0;
+        for ( auto const& q : seqs ) {
+            d += dust_low_complexity(q.data(), q.size(), 64);
+        }
+        return bench_work{ d >= 0 ? seqs.size() : 0, n_bases };
+    }));
+
+    // overlaps
+    overlap_config c;
+    c.filter.min_iden = 0.05, c.filter.min_match = 100, c.filter.min_olen = 0;
+    c.filter.min_rlen = 0, c.filter.max_indel_rate = 0.3;
+    c.keep_dups = false, c.rlen_cutoff = 0;
+    // the first pass of the engine, keeping duplicates and removing them
+    // through its pair table
+    read_table first_pass_reads;
+    first_pass_reads.resize(names.n_ids());
+    for ( bool keep_dups : { true, false } ) {
+        overlap_config k = c;
+        k.keep_dups = keep_dups;
+        results.push_back(run_micro(keep_dups ? "overlap_add" : "dedup", [&]() {
+            overlap_engine engine(k, first_pass_reads, records.size());
+            for ( size_t i = 0; i < records.size(); i++ ) {
+                engine.add(ids[i].first, ids[i].second, records[i], NULL);
+            }
+            return bench_work{ engine.kept().size() > 0 ? records.size() : 0, 0 };
+        }));
+    }
+    read_table reads;
+    reads.resize(names.n_ids());
+    results.push_back(run_micro("overlap_engine", [&]() {
+        overlap_engine engine(c, reads, records.size());
+        for ( size_t i = 0; i < records.size(); i++ ) {
+            engine.add(ids[i].first, ids[i].second, records[i], NULL);
+        }
+        engine.finish(NULL, false);
+        return bench_work{ records.size(), 0 };
+    }));
+    results.push_back(run_micro("estimate_genome_size", [&]() {
+        coverage_stats covs;
+        for ( uint32_t id = 0; id < reads.n_ids(); id++ ) {
+            if ( reads.init[id] ) {
+                covs.add(reads.cov[id], reads.max_e[id] - reads.min_s[id]);
+            }
+        }
+        gse_stats g = covs.estimate(false, false);
+        return bench_work{ uint64_t(g.tot_reads), 0 };
+    }));
+
+    // the calculate_* stages, on the values the passes over the reads leave
+    vector<pair<double, int>> fq_records;
+    for ( auto const& q : seqs ) {
+        fq_records.push_back(make_pair(100.0 * count_gc(q.data(), q.size()) / q.size(), int(q.size())));
+    }
+    FILE* null = fopen("/dev/null", "w");
+    results.push_back(run_micro("gc_content", [&]() {
+        distribution d(histogram::linear(1.0));
+        for ( auto const& r : fq_records ) {
+            if ( r.first != 0 ) {
+                d.add(r.first);
+            }
+        }
+        double peak = peak_gc_content(fq_records);
+        return bench_work{ peak >= 0 ? d.n : 0, 0 };
+    }));
+    results.push_back(run_micro("total_bases", [&]() {
+        length_curve curve(histogram::log(100));
+        for ( auto const& r : fq_records ) {
+            curve.add(r.second);
+        }
+        json_writer w(null, false);
+        curve.write(&w);
+        w.Flush();
+        return bench_work{ fq_records.size(), n_bases };
+    }));
+    // the reads stand in for the contigs of a fragmented assembly
+    vector<uint64_t> contig_lengths;
+    map<string, contig> contigs;
+    for ( size_t i = 0; i < fq_records.size(); i++ ) {
+        contig_lengths.push_back(fq_records[i].second);
+        contig c;
+        c.set(fq_records[i].second, int(opt::synth.coverage * fq_records[i].second / opt::synth.mean_len));
+        contigs.insert(make_pair(to_string(i), c));
+    }
+    results.push_back(run_micro("ngx", [&]() {
+        vector<double> xs;
+        for ( int x = 0; x <= 100; x++ ) {
+            xs.push_back(x);
+        }
+        vector<ngx_stats> s = ngx_sweep(&contig_lengths, xs, { double(opt::synth.genome_size), 2.0 * opt::synth.genome_size });
+        return bench_work{ s[0].values.empty() ? 0 : contig_lengths.size(), 0 };
+    }));
+    results.push_back(run_micro("repetitivity", [&]() {
+        repeat_bases b = classify_contigs(contigs, double(opt::synth.genome_size), int(fq_records.size()));
+        return bench_work{ b.rep + b.unique > 0 ? contigs.size() : 0, 0 };
+    }));
+    fclose(null);
+
+    results.insert(results.end(), runs.begin(), runs.end());
+
+    json_writer writer(stdout, true);
+    writer.StartObject();
+    writer.Key("config");
+    writer.StartObject();
+    writer.Key("seed");
+    writer.Uint64(opt::synth.seed);
+    writer.Key("genome_size");
+    writer.Uint64(opt::synth.genome_size);
+    writer.Key("n_reads");
+    writer.Uint64(fq_work.records);
+    writer.Key("n_overlaps");
+    writer.Uint64(paf_work.records);
+    writer.Key("error_rate");
+    writer.Double(opt::synth.error_rate);
+    writer.Key("indel_rate");
+    writer.Double(opt::synth.indel_rate);
+    writer.Key("dup_rate");
+    writer.Double(opt::synth.dup_rate);
+    writer.Key("threads");
+    writer.Uint(opt::threads);
+    writer.EndObject();
+    writer.Key("benchmarks");
+    writer.StartArray();
+    for ( auto const& r : results ) {
+        write_result(r, &writer);
+    }
+    writer.EndArray();
+    writer.EndObject();
+    writer.Flush();
+    fputc('\n', stdout);
+    return 0;
+}
+
+void parse_args(int argc, char *argv[])
+{
+    const char* const short_opts = "ht:";
+    const option long_opts[] = {
+        {"help",                no_argument,        NULL,   'h'},
+        {"dir",                 required_argument,  NULL,   OPT_DIR},
+        {"preqclr",             required_argument,  NULL,   OPT_PREQCLR},
+        {"threads",             required_argument,  NULL,   't'},
+        {"seed",                required_argument,  NULL,   OPT_SEED},
+        {"genome-size",         required_argument,  NULL,   OPT_GENOME_SIZE},
+        {"coverage",            required_argument,  NULL,   OPT_COVERAGE},
+        {"mean-len",            required_argument,  NULL,   OPT_MEAN_LEN},
+        {"n-reads",             required_argument,  NULL,   OPT_N_READS},
+        {"error-rate",          required_argument,  NULL,   OPT_ERROR_RATE},
+        {"indel-rate",          required_argument,  NULL,   OPT_INDEL_RATE},
+        {"dup-rate",            required_argument,  NULL,   OPT_DUP_RATE},
+        {"n-contigs",           required_argument,  NULL,   OPT_N_CONTIGS},
+        { NULL, 0, NULL, 0 }
+    };
+
+    static const char* PREQCLR_BENCH_USAGE_MESSAGE =
+    "usage: preqclr-bench [OPTIONS] > bench.json\n"
+    "Benchmark preqclr on synthetic reads and overlaps\n"
+    "\n"
+    "        --dir=DIR              Directory the synthetic files are written to [bench_data]\n"
+    "        --preqclr=FILE         Also time whole runs of this preqclr binary\n"
+    "    -t, --threads=INT          Number of threads of the threaded benchmarks [all cores]\n"
+    "        --seed=INT             Seed of the synthetic data [1]\n"
+    "        --genome-size=INT      Size of the random genome the reads come from [2000000]\n"
+    "        --coverage=FLOAT       Coverage of the genome by the reads [30]\n"
+    "        --mean-len=INT         Mean read length; lengths are uniform in [mean/2, 3*mean/2] [8000]\n"
+    "        --n-reads=INT          Number of reads, instead of --coverage\n"
+    "        --error-rate=FLOAT     Substitutions per base of each read [0.08]\n"
+    "        --indel-rate=FLOAT     Alignment block length added per base of an overlap [0.05]\n"
+    "        --dup-rate=FLOAT       Fraction of overlaps written twice [0.02]\n"
+    "        --n-contigs=INT        Number of contigs of the GFA and BAM files [20]\n"
+    "\n";
+
+    int c;
+    while ( (c = getopt_long(argc, argv, short_opts, long_opts, NULL)) != -1 ) {
+        std::istringstream arg(optarg != NULL ? optarg : "");
+        bool ok = true;
+        switch(c) {
+            case 'h':
+                cout << PREQCLR_BENCH_USAGE_MESSAGE << endl;
+                exit(0);
+            case OPT_DIR:
+                ok = bool(arg >> opt::dir);
+                break;
+            case OPT_PREQCLR:
+                ok = bool(arg >> opt::preqclr);
+                break;
+            case 't':
+                ok = bool(arg >> opt::threads) && opt::threads > 0;
+                break;
+            case OPT_SEED:
+                ok = bool(arg >> opt::synth.seed);
+                break;
+            case OPT_GENOME_SIZE:
+                ok = bool(arg >> opt::synth.genome_size) && opt::synth.genome_size > 0;
+                break;
+            case OPT_COVERAGE:
+                ok = bool(arg >> opt::synth.coverage) && opt::synth.coverage > 0;
+                break;
+            case OPT_MEAN_LEN:
+                ok = bool(arg >> opt::synth.mean_len) && opt::synth.mean_len > 1;
+                break;
+            case OPT_N_READS:
+                ok = bool(arg >> opt::synth.n_reads);
+                break;
+            case OPT_ERROR_RATE:
+                ok = bool(arg >> opt::synth.error_rate) && opt::synth.error_rate >= 0 && opt::synth.error_rate < 0.5;
+                break;
+            case OPT_INDEL_RATE:
+                ok = bool(arg >> opt::synth.indel_rate) && opt::synth.indel_rate >= 0;
+                break;
+            case OPT_DUP_RATE:
+                ok = bool(arg >> opt::synth.dup_rate) && opt::synth.dup_rate >= 0 && opt::synth.dup_rate <= 1;
+                break;
+            case OPT_N_CONTIGS:
+                ok = bool(arg >> opt::synth.n_contigs) && opt::synth.n_contigs > 0;
+                break;
+            default:
+                ok = false;
+                break;
+        }
+        if ( !ok ) {
+            fprintf(stderr, "preqclr-bench: invalid option or value\n\n");
+            fprintf(stderr, "%s", PREQCLR_BENCH_USAGE_MESSAGE);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+bench_result run_micro(const string& name, function<bench_work()> f)
+{
+    bench_result r;
+    r.name = name;
+    r.kind = "micro";
+    // the peak is of this benchmark when it can be reset, else of the
+    // process so far
+    bool reset = reset_peak_rss();
+    long start_rss = status_kb("VmRSS");
+    auto start = chrono::steady_clock::now();
+    r.work = f();
+    r.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    long peak = status_kb("VmHWM");
+    if ( reset && peak >= 0 && start_rss >= 0 ) {
+        r.peak_rss_kb = peak;
+        r.rss_growth_kb = peak - start_rss;
+        r.peak_rss_scope = "benchmark";
+    } else {
+        r.peak_rss_kb = peak_rss_kb(RUSAGE_SELF);
+        r.rss_growth_kb = -1;
+        r.peak_rss_scope = "process";
+    }
+    return r;
+}
+
+bench_result run_macro(const string& name, const vector<string>& args, const bench_work& work)
+{
+    // preqclr is run in the directory of the fixtures, as it reads
+    // the alignments to the contigs from there
+    bench_result r;
+    r.name = name;
+    r.kind = "macro";
+    r.work = work;
+    auto start = chrono::steady_clock::now();
+    pid_t pid = fork();
+    if ( pid == 0 ) {
+        int null = open("/dev/null", O_WRONLY);
+        if ( chdir(opt::dir.c_str()) != 0 || null < 0 || dup2(null, STDOUT_FILENO) < 0 ) {
+            _exit(127);
+        }
+        vector<char*> argv;
+        for ( auto const& a : args ) {
+            argv.push_back(const_cast<char*>(a.c_str()));
+        }
+        argv.push_back(NULL);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+    int status = 0;
+    struct rusage ru;
+    if ( pid < 0 || wait4(pid, &status, 0, &ru) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0 ) {
+        fprintf(stderr, "ERROR: benchmark %s failed; check that %s is a preqclr binary.\n\n", name.c_str(), args[0].c_str());
+        exit(EXIT_FAILURE);
+    }
+    r.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    r.peak_rss_kb = ru.ru_maxrss;
+    r.rss_growth_kb = -1;
+    r.peak_rss_scope = "benchmark";
+    // the sample name follows -n
+    r.stages = read_stage_times(opt::dir + "/" + args[2] + ".preqclr.log");
+    return r;
+}
+
+map<string, double> read_stage_times(const string& log)
+{
+    // stages may run at the same time, each logs the time it took:
+    // "[+] Time elapsed in parse_paf: 1.5s, CPU time: 1.2s"
+    static const string prefix = "[+] Time elapsed in ";
+    map<string, double> stages;
+    ifstream in(log);
+    string line;
+    while ( getline(in, line) ) {
+        if ( line.compare(0, prefix.size(), prefix) != 0 ) {
+            continue;
+        }
+        size_t e = line.find(": ", prefix.size());
+        if ( e != string::npos ) {
+            stages[line.substr(prefix.size(), e - prefix.size())] = atof(line.c_str() + e + 2);
+        }
+    }
+    return stages;
+}
+
+void write_result(const bench_result& r, json_writer* writer)
+{
+    writer->StartObject();
+    writer->Key("name");
+    writer->String(r.name.c_str());
+    writer->Key("kind");
+    writer->String(r.kind.c_str());
+    writer->Key("records");
+    writer->Uint64(r.work.records);
+    writer->Key("bytes");
+    writer->Uint64(r.work.bytes);
+    writer->Key("seconds");
+    writer->Double(r.seconds);
+    writer->Key("records_per_s");
+    writer->Double(r.seconds > 0 ? r.work.records / r.seconds : 0);
+    writer->Key("mb_per_s");
+    writer->Double(r.seconds > 0 ? r.work.bytes / r.seconds / 1e6 : 0);
+    writer->Key("peak_rss_kb");
+    writer->Int64(r.peak_rss_kb);
+    writer->Key("peak_rss_scope");
+    writer->String(r.peak_rss_scope.c_str());
+    if ( r.rss_growth_kb >= 0 ) {
+        writer->Key("rss_growth_kb");
+        writer->Int64(r.rss_growth_kb);
+    }
+    if ( !r.stages.empty() ) {
+        writer->Key("stages");
+        writer->StartObject();
+        for ( auto const& s : r.stages ) {
+            writer->Key(s.first.c_str());
+            writer->Double(s.second);
+        }
+        writer->EndObject();
+    }
+    writer->EndObject();
+}
@@ -0,0 +1,47 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr bench -- micro- and macro-benchmarks on synthetic data
+//
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <functional>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "json_writer.hpp"
+#include "synth.hpp"
+
+using namespace std;
+
+// records and bytes processed by one run of a benchmark
+struct bench_work
+{
+    uint64_t records;
+    uint64_t bytes;
+};
+
+struct bench_result
+{
+    string name;
+    string kind;                // micro: a kernel in this process; macro: a preqclr run
+    bench_work work;
+    double seconds;
+    long peak_rss_kb;           // during a micro, or of the run for macro; see peak_rss_scope
+    string peak_rss_scope;      // benchmark, or process when a micro's peak is of the process so far
+    long rss_growth_kb;         // of a micro, its peak over the RSS it started with; -1 if unknown
+    map<string, double> stages; // wall-clock seconds of each stage of a macro run
+};
+
+enum { OPT_DIR, OPT_PREQCLR, OPT_SEED, OPT_GENOME_SIZE, OPT_COVERAGE, OPT_MEAN_LEN, OPT_N_READS, OPT_ERROR_RATE, OPT_INDEL_RATE, OPT_DUP_RATE, OPT_N_CONTIGS };
+void parse_args(int argc, char *argv[]);
+bench_result run_micro(const string& name, function<bench_work()> f);
+bench_result run_macro(const string& name, const vector<string>& args, const bench_work& work);
+map<string, double> read_stage_times(const string& log);
+void write_result(const bench_result& r, json_writer* writer);
+
+#endif
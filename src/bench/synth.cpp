@@ -0,0 +1,279 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr synth -- deterministic synthetic reads, all-vs-all overlaps
+// and assembly fixtures for the benchmarks
+//
+#include "synth.hpp"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <htslib/hts.h>
+#include <htslib/sam.h>
+
+using namespace std;
+
+static const char BASES[] = "ACGT";
+
+// splitmix64: small, fast, and the same sequence on every platform
+struct rng
+{
+    uint64_t s;
+
+    rng(uint64_t seed) : s(seed) {}
+
+    uint64_t next()
+    {
+        uint64_t z = (s += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // uniform in [0, n)
+    uint64_t uniform(uint64_t n)
+    {
+        return n == 0 ? 0 : next() % n;
+    }
+
+    // uniform in [0, 1)
+    double real()
+    {
+        return (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+};
+
+static FILE* open_output(const string& fn)
+{
+    FILE* fp = fopen(fn.c_str(), "w");
+    if ( fp == NULL ) {
+        fprintf(stderr, "ERROR: failed to open %s for writing.\n\n", fn.c_str());
+        exit(EXIT_FAILURE);
+    }
+    static const size_t BUFFER_SIZE = 1 << 20;
+    setvbuf(fp, NULL, _IOFBF, BUFFER_SIZE);
+    return fp;
+}
+
+static void close_output(const string& fn, FILE* fp)
+{
+    if ( ferror(fp) || fclose(fp) != 0 ) {
+        fprintf(stderr, "ERROR: failed to write %s.\n\n", fn.c_str());
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void reverse_complement(string& s)
+{
+    reverse(s.begin(), s.end());
+    for ( auto& c : s ) {
+        switch ( c ) {
+            case 'A': c = 'T'; break;
+            case 'C': c = 'G'; break;
+            case 'G': c = 'C'; break;
+            case 'T': c = 'A'; break;
+        }
+    }
+}
+
+synth_config default_synth_config()
+{
+    synth_config c;
+    c.seed = 1;
+    c.genome_size = 2000000;
+    c.coverage = 30;
+    c.mean_len = 8000;
+    c.n_reads = 0;
+    c.error_rate = 0.08;
+    c.indel_rate = 0.05;
+    c.dup_rate = 0.02;
+    c.min_overlap = 500;
+    c.n_contigs = 20;
+    return c;
+}
+
+synth::synth(const synth_config& c) : config(c)
+{
+    rng r(config.seed);
+    genome.resize(config.genome_size);
+    for ( auto& b : genome ) {
+        b = BASES[r.next() & 3];
+    }
+
+    size_t n = config.n_reads;
+    if ( n == 0 ) {
+        n = ceil(config.coverage * config.genome_size / config.mean_len);
+    }
+    reads.resize(n);
+    for ( auto& x : reads ) {
+        x.len = config.mean_len / 2 + r.uniform(config.mean_len + 1);
+        x.len = min<uint64_t>(max<uint32_t>(x.len, 1), config.genome_size);
+        x.start = r.uniform(config.genome_size - x.len + 1);
+        x.rev = r.next() & 1;
+        x.seq = genome.substr(x.start, x.len);
+        // substitutions, at gaps drawn from the geometric distribution
+        if ( config.error_rate > 0 ) {
+            double l = log(1.0 - min(config.error_rate, 0.999));
+            double p = floor(log(1.0 - r.real()) / l);
+            while ( p < x.len ) {
+                char& b = x.seq[p];
+                b = BASES[(string(BASES).find(b) + 1 + r.uniform(3)) & 3];
+                p += 1 + floor(log(1.0 - r.real()) / l);
+            }
+        }
+    }
+}
+
+string synth::name(size_t i) const
+{
+    return "read" + to_string(i);
+}
+
+uint64_t synth::contig_len() const
+{
+    uint64_t n = max<uint32_t>(config.n_contigs, 1);
+    return (config.genome_size + n - 1) / n;
+}
+
+size_t synth::n_reads() const
+{
+    return reads.size();
+}
+
+uint64_t synth::n_bases() const
+{
+    uint64_t n = 0;
+    for ( auto const& x : reads ) {
+        n += x.len;
+    }
+    return n;
+}
+
+size_t synth::write_fastq(const string& fn) const
+{
+    FILE* fp = open_output(fn);
+    string s, q;
+    for ( size_t i = 0; i < reads.size(); i++ ) {
+        s = reads[i].seq;
+        if ( reads[i].rev ) {
+            reverse_complement(s);
+        }
+        q.assign(s.size(), '5');
+        fprintf(fp, "@%s\n%s\n+\n%s\n", name(i).c_str(), s.c_str(), q.c_str());
+    }
+    close_output(fn, fp);
+    return reads.size();
+}
+
+size_t synth::write_paf(const string& fn) const
+{
+    FILE* fp = open_output(fn);
+    rng r(config.seed ^ 0x5bd1e995ULL);
+    // reads by start on the genome, so the reads overlapping a read follow it
+    vector<size_t> order(reads.size());
+    for ( size_t i = 0; i < order.size(); i++ ) {
+        order[i] = i;
+    }
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) { return reads[a].start < reads[b].start; });
+
+    // coordinates of the genome interval [s, e) on read x
+    auto on_read = [](const read& x, uint64_t s, uint64_t e, uint64_t* rs, uint64_t* re) {
+        if ( !x.rev ) {
+            *rs = s - x.start, *re = e - x.start;
+        } else {
+            *rs = x.start + x.len - e, *re = x.start + x.len - s;
+        }
+    };
+    size_t n = 0;
+    for ( size_t p = 0; p < order.size(); p++ ) {
+        const read& a = reads[order[p]];
+        uint64_t a_end = a.start + a.len;
+        for ( size_t q = p + 1; q < order.size() && reads[order[q]].start < a_end; q++ ) {
+            const read& b = reads[order[q]];
+            uint64_t s = b.start, e = min(a_end, b.start + b.len);
+            if ( e - s < config.min_overlap ) {
+                continue;
+            }
+            uint64_t qs, qe, ts, te;
+            on_read(a, s, e, &qs, &qe);
+            on_read(b, s, e, &ts, &te);
+            // both reads have errors, the alignment has indels
+            double ml = (e - s) * max(0.0, 1.0 - 2 * config.error_rate);
+            double bl = (e - s) * (1.0 + config.indel_rate);
+            int copies = r.real() < config.dup_rate ? 2 : 1;
+            for ( int k = 0; k < copies; k++ ) {
+                // a duplicate is a shorter alignment of the same pair
+                double f = k == 0 ? 1.0 : 0.9;
+                fprintf(fp, "%s\t%u\t%lu\t%lu\t%c\t%s\t%u\t%lu\t%lu\t%lu\t%lu\t255\ttp:A:S\n",
+                        name(order[p]).c_str(), a.len, (unsigned long)qs, (unsigned long)qe, a.rev != b.rev ? '-' : '+',
+                        name(order[q]).c_str(), b.len, (unsigned long)ts, (unsigned long)te,
+                        (unsigned long)(ml * f), (unsigned long)(bl * f));
+                n++;
+            }
+        }
+    }
+    close_output(fn, fp);
+    return n;
+}
+
+size_t synth::write_gfa(const string& fn) const
+{
+    FILE* fp = open_output(fn);
+    fprintf(fp, "H\tVN:Z:1.0\n");
+    uint64_t l = contig_len();
+    size_t n = 0;
+    for ( uint64_t s = 0; s < config.genome_size; s += l, n++ ) {
+        fprintf(fp, "S\tctg%zu\t*\tLN:i:%lu\n", n, (unsigned long)min(l, config.genome_size - s));
+    }
+    close_output(fn, fp);
+    return n;
+}
+
+size_t synth::write_bam(const string& fn) const
+{
+    uint64_t l = contig_len();
+    string text = "@HD\tVN:1.6\tSO:unsorted\n";
+    vector<uint64_t> lens;
+    for ( uint64_t s = 0; s < config.genome_size; s += l ) {
+        lens.push_back(min(l, config.genome_size - s));
+        text += "@SQ\tSN:ctg" + to_string(lens.size() - 1) + "\tLN:" + to_string(lens.back()) + "\n";
+    }
+
+    htsFile* fp = hts_open(fn.c_str(), "wb");
+    bam_hdr_t* h = sam_hdr_parse(text.size(), text.c_str());
+    if ( fp == NULL || h == NULL || sam_hdr_write(fp, h) < 0 ) {
+        fprintf(stderr, "ERROR: failed to write %s.\n\n", fn.c_str());
+        exit(EXIT_FAILURE);
+    }
+    // records are written as SAM lines, parsed into BAM records
+    bam1_t* b = bam_init1();
+    vector<char> line;
+    bool ok = true;
+    for ( size_t i = 0; ok && i < reads.size(); i++ ) {
+        const read& x = reads[i];
+        uint64_t c = x.start / l;
+        uint64_t pos = x.start - c * l;
+        uint64_t in = min<uint64_t>(x.len, lens[c] - pos);
+        string cigar = to_string(in) + "M";
+        if ( in < x.len ) {
+            cigar += to_string(x.len - in) + "S";
+        }
+        string s = name(i) + "\t" + (x.rev ? "16" : "0") + "\tctg" + to_string(c) + "\t" + to_string(pos + 1) +
+                   "\t60\t" + cigar + "\t*\t0\t0\t" + x.seq + "\t*";
+        line.assign(s.begin(), s.end());
+        line.push_back(0);
+        kstring_t ks;
+        ks.l = s.size(), ks.m = line.size(), ks.s = line.data();
+        ok = sam_parse1(&ks, h, b) >= 0 && sam_write1(fp, h, b) >= 0;
+    }
+    bam_destroy1(b);
+    bam_hdr_destroy(h);
+    if ( hts_close(fp) != 0 || !ok ) {
+        fprintf(stderr, "ERROR: failed to write %s.\n\n", fn.c_str());
+        exit(EXIT_FAILURE);
+    }
+    return reads.size();
+}
@@ -0,0 +1,68 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr synth -- deterministic synthetic reads, all-vs-all overlaps
+// and assembly fixtures for the benchmarks
+//
+#ifndef SYNTH_HPP
+#define SYNTH_HPP
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct synth_config
+{
+    uint64_t seed;
+    uint64_t genome_size;
+    double coverage;
+    uint32_t mean_len;      // read lengths are uniform in [mean_len/2, 3*mean_len/2]
+    uint32_t n_reads;       // 0: enough reads for the coverage
+    double error_rate;      // substitutions per base of each read
+    double indel_rate;      // alignment block length added to each overlap, per base
+    double dup_rate;        // fraction of overlaps written a second time, shorter
+    uint32_t min_overlap;   // shorter overlaps are not written
+    uint32_t n_contigs;     // contigs of the assembly fixtures
+};
+
+synth_config default_synth_config();
+
+// reads sampled from a random genome; the same config gives the same files
+class synth
+{
+  public:
+    synth(const synth_config& c);
+
+    // each returns the number of records written, exits on write errors
+    size_t write_fastq(const string& fn) const;
+    // overlaps of every pair of reads sharing min_overlap bases of the genome
+    size_t write_paf(const string& fn) const;
+    // the genome cut into n_contigs contigs, as segments
+    size_t write_gfa(const string& fn) const;
+    // reads aligned to the contigs of write_gfa, in read order
+    size_t write_bam(const string& fn) const;
+
+    size_t n_reads() const;
+    uint64_t n_bases() const;
+
+  private:
+    struct read
+    {
+        uint64_t start;     // on the genome
+        uint32_t len;
+        bool rev;
+        string seq;         // genome strand, with errors
+    };
+
+    synth_config config;
+    string genome;
+    vector<read> reads;
+
+    string name(size_t i) const;
+    uint64_t contig_len() const;
+};
+
+#endif
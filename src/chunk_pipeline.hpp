@@ -0,0 +1,251 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr chunk_pipeline -- reads an input in chunks on one thread,
+// processes the chunks on worker threads and hands them back in
+// input order
+//
+#ifndef CHUNK_PIPELINE_HPP
+#define CHUNK_PIPELINE_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+using namespace std;
+
+// T is a chunk type with a size_t id member
+template<typename T>
+class chunk_pipeline
+{
+  public:
+    // fill reads the next chunk of input into c, returns false once the input is read
+    // process is called on each filled chunk, from any worker thread
+    // with a single thread, both are called by the caller in next()
+    chunk_pipeline(unsigned int n_threads, function<bool(T*)> fill, function<void(T*)> process);
+    ~chunk_pipeline();
+
+    // next processed chunk in input order, NULL once the input is read
+    T* next();
+    // gives a chunk back to be refilled
+    void release(T* c);
+    // seconds each thread spent filling or processing chunks, the
+    // reading thread first; a single entry with a single thread
+    vector<double> busy_times();
+    // CPU seconds of the reading and worker threads; 0 with a single
+    // thread, where the work is on the caller's thread
+    double cpu_time();
+
+  private:
+    unsigned int n_threads;
+    function<bool(T*)> fill;
+    function<void(T*)> process;
+
+    mutex m;
+    condition_variable cv;
+    vector<unique_ptr<T>> chunks;
+    vector<T*> pool;
+    deque<T*> todo;
+    map<size_t, T*> done;
+    size_t n_read, n_next;
+    bool read_done;
+    bool stop;
+    vector<thread> threads;
+    vector<double> busy;    // each slot is only written by its thread
+    vector<double> cpu;     // as busy, only with several threads
+
+    T* get_chunk();
+    void read_loop();
+    void work_loop(size_t slot);
+    static double thread_cpu();
+};
+
+template<typename T>
+chunk_pipeline<T>::chunk_pipeline(unsigned int t, function<bool(T*)> f, function<void(T*)> p)
+    : n_threads(t), fill(f), process(p), n_read(0), n_next(0), read_done(false), stop(false),
+      busy(t > 1 ? t + 1 : 1, 0.0), cpu(busy.size(), 0.0)
+{
+    if ( n_threads > 1 ) {
+        threads.push_back(thread(&chunk_pipeline<T>::read_loop, this));
+        for ( unsigned int i = 0; i < n_threads; i++ ) {
+            threads.push_back(thread(&chunk_pipeline<T>::work_loop, this, i + 1));
+        }
+    }
+}
+
+template<typename T>
+chunk_pipeline<T>::~chunk_pipeline()
+{
+    {
+        lock_guard<mutex> lock(m);
+        stop = true;
+    }
+    cv.notify_all();
+    for ( auto& t : threads ) {
+        t.join();
+    }
+}
+
+template<typename T>
+T* chunk_pipeline<T>::get_chunk()
+{
+    // called with m locked
+    if ( !pool.empty() ) {
+        T* c = pool.back();
+        pool.pop_back();
+        return c;
+    }
+    chunks.push_back(unique_ptr<T>(new T));
+    return chunks.back().get();
+}
+
+template<typename T>
+void chunk_pipeline<T>::read_loop()
+{
+    // bound the number of chunks in memory
+    size_t max_chunks = 2 * n_threads + 2;
+    while ( true ) {
+        T* c;
+        {
+            unique_lock<mutex> lock(m);
+            cv.wait(lock, [&]{ return stop || !pool.empty() || chunks.size() < max_chunks; });
+            if ( stop ) {
+                return;
+            }
+            c = get_chunk();
+        }
+        auto start = chrono::steady_clock::now();
+        double start_cpu = thread_cpu();
+        bool more = fill(c);
+        busy[0] += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cpu[0] += thread_cpu() - start_cpu;
+        {
+            lock_guard<mutex> lock(m);
+            if ( more ) {
+                c->id = n_read++;
+                todo.push_back(c);
+            } else {
+                pool.push_back(c);
+                read_done = true;
+            }
+        }
+        cv.notify_all();
+        if ( !more ) {
+            return;
+        }
+    }
+}
+
+template<typename T>
+void chunk_pipeline<T>::work_loop(size_t slot)
+{
+    while ( true ) {
+        T* c;
+        {
+            unique_lock<mutex> lock(m);
+            cv.wait(lock, [&]{ return stop || !todo.empty() || read_done; });
+            if ( stop || todo.empty() ) {
+                return;
+            }
+            c = todo.front();
+            todo.pop_front();
+        }
+        auto start = chrono::steady_clock::now();
+        double start_cpu = thread_cpu();
+        process(c);
+        busy[slot] += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cpu[slot] += thread_cpu() - start_cpu;
+        {
+            lock_guard<mutex> lock(m);
+            done[c->id] = c;
+        }
+        cv.notify_all();
+    }
+}
+
+template<typename T>
+T* chunk_pipeline<T>::next()
+{
+    if ( n_threads <= 1 ) {
+        if ( read_done ) {
+            return NULL;
+        }
+        T* c = get_chunk();
+        auto start = chrono::steady_clock::now();
+        bool more = fill(c);
+        if ( more ) {
+            c->id = n_read++;
+            process(c);
+        }
+        busy[0] += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if ( !more ) {
+            pool.push_back(c);
+            read_done = true;
+            return NULL;
+        }
+        return c;
+    }
+
+    // chunks are processed out of order, hand them out in input order
+    unique_lock<mutex> lock(m);
+    cv.wait(lock, [&]{ return done.count(n_next) > 0 || (read_done && n_next == n_read); });
+    auto i = done.find(n_next);
+    if ( i == done.end() ) {
+        return NULL;
+    }
+    T* c = i->second;
+    done.erase(i);
+    n_next++;
+    return c;
+}
+
+template<typename T>
+void chunk_pipeline<T>::release(T* c)
+{
+    {
+        lock_guard<mutex> lock(m);
+        pool.push_back(c);
+    }
+    cv.notify_all();
+}
+
+template<typename T>
+vector<double> chunk_pipeline<T>::busy_times()
+{
+    // the threads add to their slot before handing the chunk back under the lock
+    lock_guard<mutex> lock(m);
+    return busy;
+}
+
+template<typename T>
+double chunk_pipeline<T>::cpu_time()
+{
+    lock_guard<mutex> lock(m);
+    double t = 0;
+    if ( n_threads > 1 ) {
+        for ( auto const& c : cpu ) {
+            t += c;
+        }
+    }
+    return t;
+}
+
+template<typename T>
+double chunk_pipeline<T>::thread_cpu()
+{
+    struct timespec ts;
+    if ( clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0 ) {
+        return 0;
+    }
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#endif
@@ -8,12 +8,34 @@
 #include "contig.hpp"
 #include <string>
 #include <iostream>
+#include <math.h>
 
 using namespace std;
 
-void contig::set(int l, int n)
+void contig::set(uint64_t l, int n)
 {
     len = l;
     num_reads = n;
 }
 
+
+repeat_bases classify_contigs(const map<string, contig>& ctgs, double g, int n)
+{
+    // to calculate the astatistic for each contig
+    // we need k = the number of reads in the contig, total number of reads (n)
+    // the length of contig = l, and the gse (G)
+    repeat_bases b = { 0, 0 };
+    double singleCopyTheshold = 30.0;
+    double arrivalRate = double(n)/g;
+    for (auto const& c: ctgs){
+        int k = c.second.num_reads;
+        uint64_t l = c.second.len;
+        double astat = arrivalRate*double(l) - double(k)*log(2);
+        if ( astat >= singleCopyTheshold ) {
+            b.unique += l;
+        } else {
+            b.rep += l;
+        }
+    }
+    return b;
+}
@@ -5,6 +5,11 @@
 //
 // preqclr contig -- holds contig information calculated from miniasm
 //
+#ifndef CONTIG_HPP
+#define CONTIG_HPP
+
+#include <map>
+#include <stdint.h>
 #include <string>
 
 using namespace std;
@@ -12,6 +17,17 @@ using namespace std;
 class contig
 {
   public:
-    int len, num_reads;
-    void set(int l, int n);
+    uint64_t len;
+    int num_reads;
+    void set(uint64_t l, int n);
 };
+
+// bases of the contigs called repeats or unique by their A-statistic,
+// with n reads over a genome of size g
+struct repeat_bases
+{
+    uint64_t rep, unique;
+};
+repeat_bases classify_contigs(const map<string, contig>& ctgs, double g, int n);
+
+#endif
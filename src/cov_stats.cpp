@@ -0,0 +1,124 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr cov_stats -- genome size estimate from the coverage and
+// length of each read, in linear time
+//
+#include "cov_stats.hpp"
+#include <algorithm>
+#include <math.h>
+
+using namespace std;
+
+// width of the coverage bins used to find the mode
+static const double MODE_BIN_WIDTH = 0.25;
+
+double select_kth(vector<double>& v, size_t k)
+{
+    if ( k >= v.size() ) {
+        k = v.size() - 1;
+    }
+    nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+void coverage_stats::add(double cov, int len)
+{
+    covs.push_back(cov);
+    lens.push_back(len);
+}
+
+void coverage_stats::merge(const coverage_stats& s)
+{
+    covs.insert(covs.end(), s.covs.begin(), s.covs.end());
+    lens.insert(lens.end(), s.lens.begin(), s.lens.end());
+}
+
+size_t coverage_stats::size() const
+{
+    return covs.size();
+}
+
+gse_stats coverage_stats::estimate(bool keep_low_cov, bool keep_high_cov) const
+{
+    gse_stats g = gse_stats();
+    g.tot_reads = covs.size();
+    for ( auto const& l : lens ) {
+        g.sum_len += l;
+    }
+    if ( covs.empty() ) {
+        return g;
+    }
+
+    // get the 25th and 75th percentile item, by selection instead of sorting
+    size_t n = covs.size();
+    vector<double> v(covs);
+    double q25 = select_kth(v, ceil(n * 0.25));
+    double q75 = select_kth(v, ceil(n * 0.75));
+    double IQR = q75 - q25;
+    double bd = IQR*1.5;
+    double upperbound = round(q75 + bd);
+    double lowerbound = (round(q25 - bd)>3.0) ? round(q25 - bd) : 3.0;
+    if ( keep_low_cov ) {
+        lowerbound = 3.0;
+    }
+    if ( keep_high_cov ) {
+        upperbound = 1000;
+    }
+
+    // filter outliers: [Q25-IQR*1.5, Q75+IQR*1.5], counting the reads
+    // left in 0.25x bins starting from the lower bound
+    size_t n_bins = upperbound >= lowerbound ? size_t((upperbound - lowerbound) / MODE_BIN_WIDTH) + 1 : 0;
+    vector<int> counts(n_bins, 0);
+    vector<double> covs_f;
+    bool above_lowerbound = false;
+    for ( size_t i = 0; i < n; i++ ) {
+        double c = covs[i];
+        if ( c < lowerbound ) {
+            continue;
+        }
+        above_lowerbound = true;
+        if ( c > upperbound ) {
+            continue;
+        }
+        // bin b holds [lowerbound + b * 0.25, lowerbound + (b + 1) * 0.25);
+        // the bin edges are exact, so the division is checked against them
+        size_t b = size_t((c - lowerbound) / MODE_BIN_WIDTH);
+        while ( b > 0 && lowerbound + b * MODE_BIN_WIDTH > c ) {
+            b--;
+        }
+        while ( lowerbound + (b + 1) * MODE_BIN_WIDTH <= c ) {
+            b++;
+        }
+        counts[min(b, n_bins - 1)]++;
+        g.tot_reads_f += 1;
+        g.sum_len_f += lens[i];
+        covs_f.push_back(c);
+    }
+
+    // the mode is the upper edge of the first bin with the most reads;
+    // with reads above the lower bound but none kept, that is the first bin
+    if ( above_lowerbound ) {
+        size_t mode_bin = max_element(counts.begin(), counts.end()) - counts.begin();
+        g.mode_cov = lowerbound + (mode_bin + 1) * MODE_BIN_WIDTH;
+    }
+    if ( !covs_f.empty() ) {
+        // get the mean read length
+        g.mean_read_len = g.sum_len_f/double(g.tot_reads_f);
+        // get the median coverage
+        g.median_cov = select_kth(covs_f, ceil(covs_f.size() * 0.50));
+    }
+
+    // calculate estimated genome size
+    if ( g.mode_cov > 0 ) {
+        g.est_genome_size = ( g.tot_reads_f * g.mean_read_len ) / g.mode_cov;
+    }
+    if ( g.median_cov > 0 ) {
+        g.est_genome_size1 = ( g.tot_reads_f * g.mean_read_len ) / g.median_cov;
+    }
+    g.lowerbound = lowerbound;
+    g.upperbound = upperbound;
+    g.IQR = IQR;
+    return g;
+}
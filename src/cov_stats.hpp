@@ -0,0 +1,50 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr cov_stats -- genome size estimate from the coverage and
+// length of each read, in linear time
+//
+#ifndef COV_STATS_HPP
+#define COV_STATS_HPP
+
+#include <stddef.h>
+#include <vector>
+
+using namespace std;
+
+// genome size estimate from the coverage and overlap region length of
+// each read, before and after removing coverage outliers
+struct gse_stats
+{
+    double lowerbound, upperbound, IQR;
+    int tot_reads, tot_reads_f;
+    long long sum_len, sum_len_f;
+    double mode_cov, median_cov, mean_read_len;
+    double est_genome_size;     // with the mode coverage
+    double est_genome_size1;    // with the median coverage
+};
+
+// coverage and length of reads, added one at a time or merged from
+// other coverage_stats; estimate can be called at any point
+class coverage_stats
+{
+  public:
+    void add(double cov, int len);
+    void merge(const coverage_stats& s);
+    size_t size() const;
+
+    // reads outside [Q25 - 1.5 IQR, Q75 + 1.5 IQR] are removed, the lower
+    // bound being at least 3x; the mode is the upper edge of the fullest
+    // 0.25x bin starting from the lower bound
+    gse_stats estimate(bool keep_low_cov, bool keep_high_cov) const;
+
+  private:
+    vector<double> covs;
+    vector<int> lens;
+};
+
+// value of rank k of v, k clamped to the last value; v is reordered
+double select_kth(vector<double>& v, size_t k);
+
+#endif
@@ -0,0 +1,119 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr dust -- DUST low-complexity scores over raw sequence bytes
+// Morgulis et al. 2006, "A fast and symmetric DUST implementation
+// to mask low-complexity DNA sequences"
+//
+#include "dust.hpp"
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+using namespace std;
+
+// 2-bit code of each base, 4 for anything else
+static const uint8_t nt4[256] = {
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 0, 4, 1, 4, 4, 4, 2, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 0, 4, 1, 4, 4, 4, 2, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4
+};
+
+// no triplet: a base other than ACGT in the last three
+static const int NO_TRIPLET = -1;
+
+// index, 0..63, of the triplet ending at each base of s
+static void triplets(const char* s, size_t n, vector<int8_t>& t)
+{
+    t.resize(n);
+    unsigned int k = 0, l = 0;
+    for ( size_t i = 0; i < n; i++ ) {
+        uint8_t c = nt4[(uint8_t)s[i]];
+        if ( c < 4 ) {
+            k = ((k << 2) | c) & 63;
+            l++;
+        } else {
+            l = 0;
+        }
+        t[i] = l >= 3 ? int8_t(k) : int8_t(NO_TRIPLET);
+    }
+}
+
+double dust_score(const char* s, size_t n)
+{
+    // Cannot calculate dust scores on very short reads
+    if ( n < 6 ) {
+        return 0.0;
+    }
+    // slide a 3-mer window over the first n - 5 triplets; the sum of
+    // c*(c-1)/2 grows by the current count each time a triplet is seen
+    uint32_t counts[64];
+    memset(counts, 0, sizeof(counts));
+    uint64_t sum = 0;
+    unsigned int k = 0, l = 0;
+    for ( size_t i = 0; i + 3 < n; i++ ) {
+        uint8_t c = nt4[(uint8_t)s[i]];
+        if ( c < 4 ) {
+            k = ((k << 2) | c) & 63;
+            l++;
+        } else {
+            l = 0;
+        }
+        if ( l >= 3 ) {
+            sum += counts[k]++;
+        }
+    }
+    return double(sum) / double(n - 4);
+}
+
+double dust_low_complexity(const char* s, size_t n, unsigned int w, double threshold)
+{
+    if ( w > n ) {
+        w = n;
+    }
+    if ( w < 4 ) {
+        return 0.0;
+    }
+    static thread_local vector<int8_t> t;
+    triplets(s, n, t);
+
+    // window of bases [i - w + 1, i], holding the triplets ending at
+    // bases [i - w + 3, i]; the score is compared as sum > threshold * (l - 1)
+    uint32_t counts[64];
+    memset(counts, 0, sizeof(counts));
+    uint64_t sum = 0;
+    double max_sum = threshold * double(w - 3);
+    size_t masked = 0, masked_end = 0;
+    for ( size_t i = 0; i < n; i++ ) {
+        if ( t[i] != NO_TRIPLET ) {
+            sum += counts[t[i]]++;
+        }
+        if ( i + 1 < w ) {
+            continue;
+        }
+        size_t start = i + 1 - w;
+        if ( double(sum) > max_sum ) {
+            masked += i + 1 - ( masked_end > start ? masked_end : start );
+            masked_end = i + 1;
+        }
+        // drop the first triplet of the window before moving on
+        if ( t[start + 2] != NO_TRIPLET ) {
+            sum -= --counts[t[start + 2]];
+        }
+    }
+    return double(masked) / double(n);
+}
@@ -0,0 +1,27 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr dust -- DUST low-complexity scores over raw sequence bytes
+// Morgulis et al. 2006, "A fast and symmetric DUST implementation
+// to mask low-complexity DNA sequences"
+//
+#ifndef DUST_HPP
+#define DUST_HPP
+
+#include <stddef.h>
+
+// threshold of the symmetric DUST paper for 64 bp windows
+#define DUST_THRESHOLD 20.0
+
+// whole-read DUST score: the sum of c*(c-1)/2 over the counts c of
+// each triplet, divided by the read length - 4; 0 for reads under 6 bp
+// triplets with a base other than ACGT are not counted
+double dust_score(const char* s, size_t n);
+
+// fraction of the read covered by windows of w bases with a DUST
+// score, sum c*(c-1)/2 / (triplets in window - 1), above threshold
+// reads shorter than w are scored as a single window
+double dust_low_complexity(const char* s, size_t n, unsigned int w, double threshold = DUST_THRESHOLD);
+
+#endif
@@ -0,0 +1,119 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr fq_reader -- reads FASTA/FASTQ file in batches of reads,
+// calculating per-read values for the batches on worker threads
+//
+#include "fq_reader.hpp"
+#include <math.h>
+#include <string.h>
+
+#include "kseq.h"
+
+KSEQ_INIT(in_file_t*, in_read)
+
+using namespace std;
+
+// number of bases read for each batch
+static const size_t BATCH_BASES = 1 << 24;
+
+// finalizer of splitmix64
+static inline uint64_t mix(uint64_t k)
+{
+    k = (k ^ (k >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    k = (k ^ (k >> 27)) * 0x94d049bb133111ebULL;
+    return k ^ (k >> 31);
+}
+
+fq_reader::fq_reader(const string& fn, unsigned int n_threads, function<void(fq_batch*)> process,
+                     double sample_fraction, uint64_t seed)
+    : ks(0), n_reads(0), sample_seed(seed)
+{
+    if ( sample_fraction >= 1.0 ) {
+        sample_max = UINT64_MAX;
+    } else if ( sample_fraction <= 0.0 ) {
+        sample_max = 0;
+    } else {
+        sample_max = uint64_t(ldexp(sample_fraction, 64));
+    }
+    fp = in_open(fn.c_str(), n_threads);
+    if ( fp == 0 ) {
+        return;
+    }
+    ks = kseq_init(fp);
+    pipeline.reset(new chunk_pipeline<fq_batch>(n_threads,
+        [this](fq_batch* b) { return read_batch(b); },
+        process));
+}
+
+fq_reader::~fq_reader()
+{
+    // stop the worker threads before closing the file
+    pipeline.reset();
+    if ( ks != 0 ) {
+        kseq_destroy((kseq_t*)ks);
+    }
+    if ( fp != 0 ) {
+        in_close(fp);
+    }
+}
+
+bool fq_reader::is_open() const
+{
+    return fp != 0;
+}
+
+bool fq_reader::read_batch(fq_batch* b)
+{
+    kseq_t* seq = (kseq_t*)ks;
+    b->seqs.clear();
+    b->offsets.assign(1, 0);
+    b->sampled.clear();
+    while ( b->seqs.size() < BATCH_BASES && kseq_read(seq) >= 0 ) {
+        b->seqs.insert(b->seqs.end(), seq->seq.s, seq->seq.s + seq->seq.l);
+        b->offsets.push_back(b->seqs.size());
+        b->sampled.push_back(sampled(seq->name.s, seq->name.l));
+    }
+    b->gc.assign(b->size(), 0);
+    b->dust.assign(b->size(), 0);
+    b->low_complexity.assign(b->size(), 0);
+    return b->size() > 0;
+}
+
+bool fq_reader::sampled(const char* name, size_t l) const
+{
+    if ( sample_max == 0 ) {
+        return false;
+    }
+    // FNV-1a over the name, then mixed so the low fractions are uniform
+    uint64_t h = 0xcbf29ce484222325ULL ^ mix(sample_seed);
+    for ( size_t i = 0; i < l; i++ ) {
+        h = ( h ^ (uint8_t)name[i] ) * 0x100000001b3ULL;
+    }
+    return mix(h) <= sample_max;
+}
+
+fq_batch* fq_reader::next()
+{
+    fq_batch* b = pipeline->next();
+    if ( b != NULL ) {
+        n_reads += b->size();
+    }
+    return b;
+}
+
+void fq_reader::release(fq_batch* b)
+{
+    pipeline->release(b);
+}
+
+input_metrics fq_reader::metrics()
+{
+    input_metrics m;
+    in_stats(fp, &m.bytes_read, &m.bytes_uncompressed);
+    m.records = n_reads;
+    m.busy = pipeline->busy_times();
+    m.cpu_time = pipeline->cpu_time();
+    return m;
+}
@@ -0,0 +1,70 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr fq_reader -- reads FASTA/FASTQ file in batches of reads,
+// calculating per-read values for the batches on worker threads
+//
+#ifndef FQ_READER_HPP
+#define FQ_READER_HPP
+
+#include <functional>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "input.h"
+#include "chunk_pipeline.hpp"
+#include "metrics.hpp"
+
+using namespace std;
+
+// a batch of reads and the values calculated for them
+// the buffers are reused from one batch to the next
+struct fq_batch
+{
+    size_t id;
+    vector<char> seqs;          // sequences of the batch, back to back
+    vector<size_t> offsets;     // start of each sequence in seqs, and end of the last one
+    vector<uint8_t> sampled;    // reads we calculate GC content and DUST score for
+    vector<double> gc;
+    vector<double> dust;
+    vector<double> low_complexity;
+
+    size_t size() const { return sampled.size(); }
+    const char* seq(size_t i) const { return seqs.data() + offsets[i]; }
+    size_t len(size_t i) const { return offsets[i+1] - offsets[i]; }
+};
+
+class fq_reader
+{
+  public:
+    // process calculates the values of a batch
+    // reads are sampled by a hash of their name seeded with sample_seed,
+    // so the same reads are sampled whatever the order of the file
+    fq_reader(const string& fn, unsigned int n_threads, function<void(fq_batch*)> process,
+              double sample_fraction, uint64_t sample_seed);
+    ~fq_reader();
+    bool is_open() const;
+
+    // next batch in file order, NULL once the file is read
+    fq_batch* next();
+    void release(fq_batch* b);
+
+    // input read so far, with the reads of the batches handed out
+    input_metrics metrics();
+
+  private:
+    in_file_t* fp;
+    void* ks;   // kseq_t
+    uint64_t n_reads;
+    uint64_t sample_max;    // reads with a name hash <= sample_max are sampled
+    uint64_t sample_seed;
+    unique_ptr<chunk_pipeline<fq_batch>> pipeline;
+
+    bool read_batch(fq_batch* b);
+    bool sampled(const char* name, size_t l) const;
+};
+
+#endif
@@ -0,0 +1,162 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr gfa_reader -- reads the segments of a GFA file, with their
+// lengths, without keeping their sequences or the other records
+//
+#include "gfa_reader.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+// amount of text read at a time when the file is not mapped
+static const size_t BLOCK_SIZE = 1 << 20;
+
+gfa_reader::gfa_reader(const string& fn)
+    : p(NULL), end(NULL), mapped(false), n_segments(0)
+{
+    fp = in_open(fn.c_str(), 1);
+    if ( fp == 0 ) {
+        return;
+    }
+    size_t size;
+    p = in_mmap(fp, &size);
+    if ( p != NULL ) {
+        end = p + size;
+        mapped = true;
+    } else {
+        buf.resize(BLOCK_SIZE);
+    }
+}
+
+gfa_reader::~gfa_reader()
+{
+    if ( fp != 0 ) {
+        in_close(fp);
+    }
+}
+
+bool gfa_reader::is_open() const
+{
+    return fp != 0;
+}
+
+bool gfa_reader::fill()
+{
+    if ( mapped ) {
+        return false;
+    }
+    int n = in_read(fp, buf.data(), buf.size());
+    if ( n < 0 ) {
+        fprintf(stderr, "ERROR: failed to read GFA file. Check to see if it is truncated or corrupted.\n\n");
+        exit(EXIT_FAILURE);
+    }
+    p = buf.data();
+    end = p + n;
+    return n > 0;
+}
+
+char gfa_reader::column(string* out, uint64_t* count)
+{
+    // whether the column read so far ends in '\r', which is not counted
+    // when it is the '\r' of a "\r\n" line ending
+    bool cr = false;
+    while ( p < end || fill() ) {
+        // the column ends at the first tab of the line, or at the newline
+        const char* nl = (const char*)memchr(p, '\n', end - p);
+        const char* e = nl != NULL ? nl : end;
+        const char* tab = (const char*)memchr(p, '\t', e - p);
+        if ( tab != NULL ) {
+            e = tab;
+        }
+        if ( out != NULL ) {
+            out->append(p, e - p);
+        }
+        if ( count != NULL ) {
+            *count += e - p;
+        }
+        if ( e > p ) {
+            cr = e[-1] == '\r';
+        }
+        if ( e < end ) {
+            if ( *e == '\n' && cr ) {
+                if ( out != NULL ) {
+                    out->pop_back();
+                }
+                if ( count != NULL ) {
+                    (*count)--;
+                }
+            }
+            p = e + 1;
+            return *e;
+        }
+        p = end;
+    }
+    return 0;
+}
+
+void gfa_reader::skip_line()
+{
+    while ( p < end || fill() ) {
+        const char* nl = (const char*)memchr(p, '\n', end - p);
+        if ( nl != NULL ) {
+            p = nl + 1;
+            return;
+        }
+        p = end;
+    }
+}
+
+bool gfa_reader::next(gfa_segment* s)
+{
+    while ( p < end || fill() ) {
+        // only S lines are parsed, the record type is the first column
+        if ( *p != 'S' ) {
+            skip_line();
+            continue;
+        }
+        // the first column must be "S" itself, not only start with it
+        p++;
+        uint64_t rest = 0;
+        char d = column(NULL, &rest);
+        if ( d != '\t' || rest != 0 ) {
+            if ( d == '\t' ) {
+                skip_line();
+            }
+            continue;
+        }
+        s->name.clear();
+        d = column(&s->name, NULL);
+
+        // the sequence is only measured; "*" when it is not in the file
+        uint64_t l = 0;
+        bool star = false;
+        if ( d == '\t' && (p < end || fill()) ) {
+            star = *p == '*';
+            d = column(NULL, &l);
+        }
+        s->len = star && l == 1 ? 0 : l;
+        while ( d == '\t' ) {
+            tag.clear();
+            d = column(&tag, NULL);
+            if ( tag.compare(0, 5, "LN:i:") == 0 ) {
+                s->len = strtoull(tag.c_str() + 5, NULL, 10);
+            }
+        }
+        n_segments++;
+        return true;
+    }
+    return false;
+}
+
+input_metrics gfa_reader::metrics()
+{
+    input_metrics m;
+    in_stats(fp, &m.bytes_read, &m.bytes_uncompressed);
+    m.records = n_segments;
+    m.cpu_time = 0;
+    return m;
+}
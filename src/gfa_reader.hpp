@@ -0,0 +1,58 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr gfa_reader -- reads the segments of a GFA file, with their
+// lengths, without keeping their sequences or the other records
+//
+#ifndef GFA_READER_HPP
+#define GFA_READER_HPP
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "input.h"
+#include "metrics.hpp"
+
+using namespace std;
+
+// an S line: the length is from its LN:i tag, or else its sequence
+struct gfa_segment
+{
+    string name;
+    uint64_t len;
+};
+
+class gfa_reader
+{
+  public:
+    // uncompressed files are mapped, the others read in blocks
+    gfa_reader(const string& fn);
+    ~gfa_reader();
+    bool is_open() const;
+
+    // next segment of the file, false once the file is read
+    bool next(gfa_segment* s);
+
+    input_metrics metrics();
+
+  private:
+    in_file_t* fp;
+    vector<char> buf;
+    const char* p;      // text not scanned yet, up to end
+    const char* end;
+    bool mapped;
+    uint64_t n_segments;
+    string tag;
+
+    // false at the end of the file
+    bool fill();
+    // the rest of a column, appended to out or counted in count, without
+    // the '\r' of a "\r\n" ending; returns the tab or newline ending it,
+    // 0 at the end of the file
+    char column(string* out, uint64_t* count);
+    void skip_line();
+};
+
+#endif
@@ -0,0 +1,274 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr input -- reads plain, gzip, BGZF or zstd compressed
+// input files, detecting the format from the first bytes
+//
+#define _POSIX_C_SOURCE 200809L // fileno
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include <htslib/bgzf.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include "input.h"
+
+// compressed bytes read from the file at a time
+#define IN_BUF_SIZE 0x20000
+// bytes needed to tell the formats apart: a BGZF header
+#define IN_PEEK_SIZE 18
+
+struct in_file_s {
+    in_format_t format;
+    int fd;
+    unsigned char peek[IN_PEEK_SIZE];   // first bytes of the file, read before anything else
+    int peek_l, peek_pos;
+    int eof;
+    unsigned char *buf;                 // compressed input
+    BGZF *bgzf;
+    z_stream z;
+    int in_member;                      // inside a gzip member or zstd frame
+    void *map;                          // whole file, with in_mmap
+    size_t map_l;
+    uint64_t n_raw, n_out;              // bytes read from the file, bytes returned by in_read
+#ifdef HAVE_ZSTD
+    ZSTD_DStream *zs;
+    ZSTD_inBuffer zin;
+#endif
+};
+
+// reads from the file, starting with the bytes peeked at
+static int raw_read(in_file_t *f, unsigned char *buf, int len)
+{
+    if (f->peek_pos < f->peek_l) {
+        int n = f->peek_l - f->peek_pos;
+        if (n > len) n = len;
+        memcpy(buf, f->peek + f->peek_pos, n);
+        f->peek_pos += n;
+        return n;
+    }
+    while (1) {
+        ssize_t n = read(f->fd, buf, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n > 0) f->n_raw += n;
+        return (int)n;
+    }
+}
+
+static in_format_t detect_format(const unsigned char *p, int l)
+{
+    if (l >= 2 && p[0] == 0x1f && p[1] == 0x8b) {
+        // BGZF: gzip with a 6 byte extra field holding the BC subfield
+        if (l >= 18 && (p[3] & 4) && p[10] == 6 && p[11] == 0 && p[12] == 'B' && p[13] == 'C')
+            return IN_BGZF;
+        return IN_GZIP;
+    }
+    if (l >= 4 && p[0] == 0x28 && p[1] == 0xb5 && p[2] == 0x2f && p[3] == 0xfd)
+        return IN_ZSTD;
+    return IN_PLAIN;
+}
+
+in_file_t *in_open(const char *fn, int n_threads)
+{
+    in_file_t *f;
+    int fd, n;
+    fd = fn && strcmp(fn, "-") ? open(fn, O_RDONLY) : fileno(stdin);
+    if (fd < 0) return 0;
+    f = (in_file_t*)calloc(1, sizeof(in_file_t));
+    f->fd = fd;
+    while (f->peek_l < IN_PEEK_SIZE) {
+        n = read(fd, f->peek + f->peek_l, IN_PEEK_SIZE - f->peek_l);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        f->peek_l += n;
+    }
+    f->n_raw = f->peek_l;
+    f->format = detect_format(f->peek, f->peek_l);
+
+    // htslib reads BGZF from the start of the file, so it needs to be
+    // rewound; BGZF on a pipe is read as plain gzip instead
+    if (f->format == IN_BGZF && lseek(fd, 0, SEEK_SET) == 0) {
+        f->bgzf = bgzf_dopen(fd, "r");
+        if (f->bgzf == 0) {
+            close(fd);
+            free(f);
+            return 0;
+        }
+        if (n_threads > 1) bgzf_mt(f->bgzf, n_threads, 256);
+        return f;
+    }
+    if (f->format == IN_BGZF) f->format = IN_GZIP;
+
+    if (f->format == IN_GZIP) {
+        // 15 + 32: gzip header, maximum window
+        if (inflateInit2(&f->z, 15 + 32) != Z_OK) {
+            in_close(f);
+            return 0;
+        }
+    } else if (f->format == IN_ZSTD) {
+#ifdef HAVE_ZSTD
+        f->zs = ZSTD_createDStream();
+        if (f->zs == 0 || ZSTD_isError(ZSTD_initDStream(f->zs))) {
+            in_close(f);
+            return 0;
+        }
+#else
+        fprintf(stderr, "ERROR: %s is zstd compressed, but preqclr was built without zstd support. Rebuild with make ZSTD=1.\n\n", fn && strcmp(fn, "-") ? fn : "stdin");
+        in_close(f);
+        return 0;
+#endif
+    }
+    if (f->format != IN_PLAIN) f->buf = (unsigned char*)malloc(IN_BUF_SIZE);
+    return f;
+}
+
+static int gzip_read(in_file_t *f, unsigned char *buf, int len)
+{
+    z_stream *z = &f->z;
+    z->next_out = buf;
+    z->avail_out = len;
+    while (z->avail_out > 0) {
+        int ret;
+        if (z->avail_in == 0) {
+            int n;
+            if (f->eof) break;
+            n = raw_read(f, f->buf, IN_BUF_SIZE);
+            if (n < 0) return -1;
+            if (n == 0) {
+                f->eof = 1;
+                // truncated member
+                if (f->in_member) return -1;
+                break;
+            }
+            z->next_in = f->buf;
+            z->avail_in = n;
+        }
+        f->in_member = 1;
+        ret = inflate(z, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            // concatenated gzip files and BGZF blocks are members of their own
+            f->in_member = 0;
+            inflateReset(z);
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            return -1;
+        }
+    }
+    return len - (int)z->avail_out;
+}
+
+#ifdef HAVE_ZSTD
+static int zstd_read(in_file_t *f, unsigned char *buf, int len)
+{
+    ZSTD_outBuffer out = { buf, (size_t)len, 0 };
+    while (out.pos < out.size) {
+        size_t ret;
+        if (f->zin.pos == f->zin.size) {
+            int n;
+            if (f->eof) break;
+            n = raw_read(f, f->buf, IN_BUF_SIZE);
+            if (n < 0) return -1;
+            if (n == 0) {
+                f->eof = 1;
+                // truncated frame
+                if (f->in_member) return -1;
+                break;
+            }
+            f->zin.src = f->buf;
+            f->zin.size = n;
+            f->zin.pos = 0;
+        }
+        ret = ZSTD_decompressStream(f->zs, &out, &f->zin);
+        if (ZSTD_isError(ret)) return -1;
+        // 0 once a frame is complete
+        f->in_member = ret != 0;
+    }
+    return (int)out.pos;
+}
+#endif
+
+static int format_read(in_file_t *f, void *buf, int len)
+{
+    switch (f->format) {
+    case IN_BGZF:
+        return (int)bgzf_read(f->bgzf, buf, len);
+    case IN_GZIP:
+        return gzip_read(f, (unsigned char*)buf, len);
+#ifdef HAVE_ZSTD
+    case IN_ZSTD:
+        return zstd_read(f, (unsigned char*)buf, len);
+#endif
+    default:
+        return raw_read(f, (unsigned char*)buf, len);
+    }
+}
+
+int in_read(in_file_t *f, void *buf, int len)
+{
+    int n = format_read(f, buf, len);
+    if (n > 0) f->n_out += n;
+    return n;
+}
+
+in_format_t in_format(const in_file_t *f)
+{
+    return f->format;
+}
+
+const char *in_mmap(in_file_t *f, size_t *size)
+{
+    struct stat st;
+    void *p;
+    if (f->format != IN_PLAIN) return 0;
+    if (f->map == 0) {
+        if (fstat(f->fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) return 0;
+        p = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, f->fd, 0);
+        if (p == MAP_FAILED) return 0;
+        posix_madvise(p, st.st_size, POSIX_MADV_SEQUENTIAL);
+        f->map = p;
+        f->map_l = st.st_size;
+    }
+    *size = f->map_l;
+    return (const char*)f->map;
+}
+
+void in_stats(const in_file_t *f, uint64_t *raw, uint64_t *out)
+{
+    struct stat st;
+    *raw = f->n_raw;
+    *out = f->n_out;
+    if (f->map) {
+        *raw = *out = f->map_l;
+    } else if (f->bgzf) {
+        // htslib reads the blocks itself; once the input is read,
+        // that is the whole file
+        if (fstat(f->fd, &st) == 0 && S_ISREG(st.st_mode)) *raw = st.st_size;
+    }
+}
+
+int in_close(in_file_t *f)
+{
+    int ret = 0;
+    if (f == 0) return 0;
+    if (f->map) munmap(f->map, f->map_l);
+    if (f->bgzf) {
+        // closes fd
+        ret = bgzf_close(f->bgzf);
+    } else {
+        if (f->format == IN_GZIP) inflateEnd(&f->z);
+#ifdef HAVE_ZSTD
+        if (f->zs) ZSTD_freeDStream(f->zs);
+#endif
+        ret = close(f->fd);
+    }
+    free(f->buf);
+    free(f);
+    return ret;
+}
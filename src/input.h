@@ -0,0 +1,40 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr input -- reads plain, gzip, BGZF or zstd compressed
+// input files, detecting the format from the first bytes
+//
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum { IN_PLAIN, IN_GZIP, IN_BGZF, IN_ZSTD } in_format_t;
+
+typedef struct in_file_s in_file_t;
+
+// fn is NULL or "-" for stdin; BGZF files are inflated on n_threads
+// threads when the file can be rewound, everything else on the caller
+in_file_t *in_open(const char *fn, int n_threads);
+// reads up to len bytes; returns 0 at the end of the input, <0 on error
+int in_read(in_file_t *f, void *buf, int len);
+in_format_t in_format(const in_file_t *f);
+// maps an uncompressed regular file read-only, NULL for anything else;
+// the mapping is valid until in_close
+const char *in_mmap(in_file_t *f, size_t *size);
+// bytes read from the file and bytes of input returned so far;
+// a mapped file counts as read whole
+void in_stats(const in_file_t *f, uint64_t *raw, uint64_t *out);
+int in_close(in_file_t *f);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
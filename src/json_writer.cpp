@@ -0,0 +1,318 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr json_writer -- streams the preqclr JSON document to a file
+// through a fixed-size buffer, either indented or compact; stages running
+// at the same time write through deferred writers, in turn
+//
+#include "json_writer.hpp"
+#include <stdlib.h>
+
+using namespace std;
+using namespace rapidjson;
+
+// size of the buffer between the writer and the file
+static const size_t BUFFER_SIZE = 1 << 16;
+// values a deferred writer holds in memory before it moves them to its file
+static const size_t MAX_HELD = 1 << 16;
+
+json_writer::json_writer(FILE* fp, bool p)
+    : buffer(BUFFER_SIZE), os(new FileWriteStream(fp, buffer.data(), buffer.size())),
+      pretty_writer(new PrettyWriter<FileWriteStream>(*os)), compact_writer(new Writer<FileWriteStream>(*os)),
+      pretty(p), target(NULL), spill(NULL), released(false), passing(false)
+{
+}
+
+json_writer::json_writer(json_writer* t)
+    : pretty(t->pretty), target(t), spill(NULL), released(false), passing(false)
+{
+}
+
+json_writer::~json_writer()
+{
+    if ( spill != NULL ) {
+        fclose(spill);
+    }
+}
+
+bool json_writer::Key(const char* s)
+{
+    if ( target != NULL ) {
+        json_writer* w = pass();
+        if ( w == NULL ) {
+            hold(KEY).s = strings.size();
+            strings.push_back(s);
+            return true;
+        }
+        return w->Key(s);
+    }
+    return pretty ? pretty_writer->Key(s) : compact_writer->Key(s);
+}
+
+bool json_writer::String(const char* s)
+{
+    if ( target != NULL ) {
+        json_writer* w = pass();
+        if ( w == NULL ) {
+            hold(STRING).s = strings.size();
+            strings.push_back(s);
+            return true;
+        }
+        return w->String(s);
+    }
+    return pretty ? pretty_writer->String(s) : compact_writer->String(s);
+}
+
+bool json_writer::Int(int i)
+{
+    if ( target != NULL ) {
+        json_writer* w = pass();
+        if ( w == NULL ) {
+            hold(INT).i = i;
+            return true;
+        }
+        return w->Int(i);
+    }
+    return pretty ? pretty_writer->Int(i) : compact_writer->Int(i);
+}
+
+bool json_writer::Uint(unsigned int u)
+{
+    if ( target != NULL ) {
+        json_writer* w = pass();
+        if ( w == NULL ) {
+            hold(UINT).u = u;
+            return true;
+        }
+        return w->Uint(u);
+    }
+    return pretty ? pretty_writer->Uint(u) : compact_writer->Uint(u);
+}
+
+bool json_writer::Int64(int64_t i)
+{
+    if ( target != NULL ) {
+        json_writer* w = pass();
+        if ( w == NULL ) {
+            hold(INT64).i = i;
+            return true;
+        }
+        return w->Int64(i);
+    }
+    return pretty ? pretty_writer->Int64(i) : compact_writer->Int64(i);
+}
+
+bool json_writer::Uint64(uint64_t u)
+{
+    if ( target != NULL ) {
+        json_writer* w = pass();
+        if ( w == NULL ) {
+            hold(UINT64).u = u;
+            return true;
+        }
+        return w->Uint64(u);
+    }
+    return pretty ? pretty_writer->Uint64(u) : compact_writer->Uint64(u);
+}
+
+bool json_writer::Double(double d)
+{
+    if ( target != NULL ) {
+        json_writer* w = pass();
+        if ( w == NULL ) {
+            hold(DOUBLE).d = d;
+            return true;
+        }
+        return w->Double(d);
+    }
+    return pretty ? pretty_writer->Double(d) : compact_writer->Double(d);
+}
+
+bool json_writer::Bool(bool b)
+{
+    if ( target != NULL ) {
+        json_writer* w = pass();
+        if ( w == NULL ) {
+            hold(BOOL).b = b;
+            return true;
+        }
+        return w->Bool(b);
+    }
+    return pretty ? pretty_writer->Bool(b) : compact_writer->Bool(b);
+}
+
+bool json_writer::StartObject()
+{
+    if ( target != NULL ) {
+        json_writer* w = pass();
+        if ( w == NULL ) {
+            hold(START_OBJECT);
+            return true;
+        }
+        return w->StartObject();
+    }
+    return pretty ? pretty_writer->StartObject() : compact_writer->StartObject();
+}
+
+bool json_writer::EndObject()
+{
+    if ( target != NULL ) {
+        json_writer* w = pass();
+        if ( w == NULL ) {
+            hold(END_OBJECT);
+            return true;
+        }
+        return w->EndObject();
+    }
+    return pretty ? pretty_writer->EndObject() : compact_writer->EndObject();
+}
+
+bool json_writer::StartArray()
+{
+    if ( target != NULL ) {
+        json_writer* w = pass();
+        if ( w == NULL ) {
+            hold(START_ARRAY);
+            return true;
+        }
+        return w->StartArray();
+    }
+    return pretty ? pretty_writer->StartArray() : compact_writer->StartArray();
+}
+
+bool json_writer::EndArray()
+{
+    if ( target != NULL ) {
+        json_writer* w = pass();
+        if ( w == NULL ) {
+            hold(END_ARRAY);
+            return true;
+        }
+        return w->EndArray();
+    }
+    return pretty ? pretty_writer->EndArray() : compact_writer->EndArray();
+}
+
+void json_writer::Flush()
+{
+    if ( target == NULL ) {
+        os->Flush();
+    }
+}
+
+void json_writer::release()
+{
+    released.store(true, memory_order_release);
+}
+
+void json_writer::drain()
+{
+    lock_guard<mutex> lock(m);
+    if ( !passing ) {
+        replay();
+        passing = true;
+    }
+}
+
+json_writer* json_writer::pass()
+{
+    // the values held are written by the first value written once released
+    if ( !passing && released.load(memory_order_acquire) ) {
+        lock_guard<mutex> lock(m);
+        if ( !passing ) {
+            replay();
+            passing = true;
+        }
+    }
+    return passing ? target : NULL;
+}
+
+json_writer::event& json_writer::hold(event_t type)
+{
+    if ( held.size() == MAX_HELD ) {
+        spill_held();
+    }
+    held.push_back(event());
+    held.back().type = type;
+    return held.back();
+}
+
+void json_writer::spill_held()
+{
+    // keys and strings follow their event, as their length and bytes
+    if ( spill == NULL ) {
+        spill = tmpfile();
+        if ( spill == NULL ) {
+            fprintf(stderr, "ERROR: failed to create a temporary file for the output of a stage.\n\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    bool ok = true;
+    for ( auto const& e : held ) {
+        ok = ok && fwrite(&e, sizeof(e), 1, spill) == 1;
+        if ( e.type == KEY || e.type == STRING ) {
+            const string& s = strings[e.s];
+            uint64_t l = s.size();
+            ok = ok && fwrite(&l, sizeof(l), 1, spill) == 1 && fwrite(s.data(), 1, l, spill) == l;
+        }
+    }
+    if ( !ok ) {
+        fprintf(stderr, "ERROR: failed to write the output of a stage to a temporary file.\n\n");
+        exit(EXIT_FAILURE);
+    }
+    held.clear();
+    strings.clear();
+}
+
+void json_writer::replay()
+{
+    if ( spill != NULL ) {
+        rewind(spill);
+        event e;
+        string s;
+        while ( fread(&e, sizeof(e), 1, spill) == 1 ) {
+            if ( e.type == KEY || e.type == STRING ) {
+                uint64_t l = 0;
+                bool ok = fread(&l, sizeof(l), 1, spill) == 1;
+                s.resize(l);
+                if ( !ok || fread(&s[0], 1, l, spill) != l ) {
+                    fprintf(stderr, "ERROR: failed to read the output of a stage from its temporary file.\n\n");
+                    exit(EXIT_FAILURE);
+                }
+                if ( e.type == KEY ) {
+                    target->Key(s.c_str());
+                } else {
+                    target->String(s.c_str());
+                }
+            } else {
+                write_event(e);
+            }
+        }
+        fclose(spill);
+        spill = NULL;
+    }
+    for ( auto const& e : held ) {
+        write_event(e);
+    }
+    vector<event>().swap(held);
+    vector<string>().swap(strings);
+}
+
+void json_writer::write_event(const event& e)
+{
+    switch ( e.type ) {
+        case KEY:           target->Key(strings[e.s].c_str()); break;
+        case STRING:        target->String(strings[e.s].c_str()); break;
+        case INT:           target->Int(int(e.i)); break;
+        case UINT:          target->Uint((unsigned int)e.u); break;
+        case INT64:         target->Int64(e.i); break;
+        case UINT64:        target->Uint64(e.u); break;
+        case DOUBLE:        target->Double(e.d); break;
+        case BOOL:          target->Bool(e.b); break;
+        case START_OBJECT:  target->StartObject(); break;
+        case END_OBJECT:    target->EndObject(); break;
+        case START_ARRAY:   target->StartArray(); break;
+        case END_ARRAY:     target->EndArray(); break;
+    }
+}
@@ -0,0 +1,91 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr json_writer -- streams the preqclr JSON document to a file
+// through a fixed-size buffer, either indented or compact; stages running
+// at the same time write through deferred writers, in turn
+//
+#ifndef JSON_WRITER_HPP
+#define JSON_WRITER_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "rapidjson/writer.h"
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/filewritestream.h"
+
+using namespace std;
+using namespace rapidjson;
+
+class json_writer
+{
+  public:
+    // fp stays owned by the caller, it must outlive the writer
+    json_writer(FILE* fp, bool pretty);
+    // a deferred writer: values are held until release, then go to
+    // target as they are written; target must outlive the writer.
+    // Past 64k values, the values held are moved to a temporary file
+    explicit json_writer(json_writer* target);
+    ~json_writer();
+
+    bool Key(const char* s);
+    bool String(const char* s);
+    bool Int(int i);
+    bool Uint(unsigned int u);
+    bool Int64(int64_t i);
+    bool Uint64(uint64_t u);
+    bool Double(double d);
+    bool Bool(bool b);
+    bool StartObject();
+    bool EndObject();
+    bool StartArray();
+    bool EndArray();
+    // write out what is left in the buffer
+    void Flush();
+
+    // deferred writers take turns writing to their target: release
+    // starts the turn, from any thread; drain ends it once nothing more
+    // is written, writing out the values still held
+    void release();
+    void drain();
+
+  private:
+    enum event_t { KEY, STRING, INT, UINT, INT64, UINT64, DOUBLE, BOOL,
+                   START_OBJECT, END_OBJECT, START_ARRAY, END_ARRAY };
+    struct event
+    {
+        event_t type;
+        union { int64_t i; uint64_t u; double d; bool b; size_t s; };
+    };
+
+    vector<char> buffer;
+    unique_ptr<FileWriteStream> os;
+    unique_ptr<PrettyWriter<FileWriteStream>> pretty_writer;
+    unique_ptr<Writer<FileWriteStream>> compact_writer;
+    bool pretty;
+
+    // deferred writers only
+    json_writer* target;
+    vector<event> held;
+    vector<string> strings;     // keys and strings of the held values
+    FILE* spill;                // values held before those in held, NULL if none
+    atomic<bool> released;
+    bool passing;               // held values written, values go to target
+    mutex m;
+
+    // target once the turn has come, NULL while values are held
+    json_writer* pass();
+    event& hold(event_t type);
+    void spill_held();
+    void write_event(const event& e);
+    void replay();
+};
+
+#endif
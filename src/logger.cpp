@@ -0,0 +1,129 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr logger -- log of a run, kept open once and written by a
+// flushing thread, so any thread can log without waiting on the file
+//
+#include "logger.hpp"
+#include <chrono>
+
+using namespace std;
+
+// lines held before writers wait for the flushing thread
+static const size_t RING_SIZE = 1024;
+// the file is flushed at least this often while lines come in
+static const chrono::milliseconds FLUSH_INTERVAL(200);
+
+logger::logger()
+    : max_level(LOG_INFO), echo(false), fp(NULL), ring(RING_SIZE), head(0), n(0), stop(false)
+{
+}
+
+logger::~logger()
+{
+    close();
+}
+
+bool logger::open(const string& fn, log_level level, bool e)
+{
+    close();
+    fp = fopen(fn.c_str(), "w");
+    if ( fp == NULL ) {
+        return false;
+    }
+    max_level = level;
+    echo = e;
+    stop = false;
+    if ( echo ) {
+        // the lines logged before were not echoed yet
+        lock_guard<mutex> lock(m);
+        for ( size_t i = 0; i < n; i++ ) {
+            fprintf(stdout, "%s\n", ring[(head + i) % RING_SIZE].c_str());
+        }
+    }
+    flusher = thread(&logger::flush_loop, this);
+    return true;
+}
+
+void logger::close()
+{
+    if ( flusher.joinable() ) {
+        {
+            lock_guard<mutex> lock(m);
+            stop = true;
+        }
+        cv_flush.notify_all();
+        flusher.join();
+    }
+    if ( fp != NULL ) {
+        fclose(fp);
+        fp = NULL;
+    }
+}
+
+void logger::write(log_level level, const string& line)
+{
+    if ( !enabled(level) ) {
+        return;
+    }
+    unique_lock<mutex> lock(m);
+    if ( echo ) {
+        // stdout is written in order with the rest of the output
+        fprintf(stdout, "%s\n", line.c_str());
+    }
+    if ( n == RING_SIZE ) {
+        if ( !flusher.joinable() ) {
+            // nothing writes the ring out before the log is opened
+            return;
+        }
+        cv_flush.notify_one();
+        cv_space.wait(lock, [&]{ return n < RING_SIZE; });
+    }
+    ring[(head + n) % RING_SIZE] = line;
+    n++;
+    if ( n >= RING_SIZE / 2 ) {
+        cv_flush.notify_one();
+    }
+}
+
+void logger::flush_loop()
+{
+    vector<string> lines;
+    while ( true ) {
+        bool done;
+        {
+            unique_lock<mutex> lock(m);
+            cv_flush.wait_for(lock, FLUSH_INTERVAL, [&]{ return stop || n >= RING_SIZE / 2; });
+            for ( ; n > 0; n-- ) {
+                lines.push_back(move(ring[head]));
+                head = (head + 1) % RING_SIZE;
+            }
+            done = stop;
+        }
+        cv_space.notify_all();
+        if ( !lines.empty() ) {
+            for ( auto const& l : lines ) {
+                fputs(l.c_str(), fp);
+                fputc('\n', fp);
+            }
+            fflush(fp);
+            lines.clear();
+        }
+        if ( done ) {
+            return;
+        }
+    }
+}
+
+bool parse_log_level(const string& s, log_level* level)
+{
+    static const char* names[] = { "error", "warning", "info", "debug" };
+    for ( int i = 0; i <= LOG_DEBUG; i++ ) {
+        if ( s == names[i] ) {
+            *level = log_level(i);
+            return true;
+        }
+    }
+    return false;
+}
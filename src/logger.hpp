@@ -0,0 +1,57 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr logger -- log of a run, kept open once and written by a
+// flushing thread, so any thread can log without waiting on the file
+//
+#ifndef LOGGER_HPP
+#define LOGGER_HPP
+
+#include <condition_variable>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+enum log_level { LOG_ERROR, LOG_WARNING, LOG_INFO, LOG_DEBUG };
+
+class logger
+{
+  public:
+    logger();
+    ~logger();
+
+    // truncates fn and starts flushing to it; lines logged before are
+    // written first. With echo, lines also go to stdout as they are logged
+    bool open(const string& fn, log_level level, bool echo);
+    // writes out the lines left and closes the file
+    void close();
+
+    // lines above the level of the log are dropped without locking
+    bool enabled(log_level level) const { return level <= max_level; }
+    void write(log_level level, const string& line);
+
+  private:
+    log_level max_level;
+    bool echo;
+    FILE* fp;
+
+    mutex m;
+    condition_variable cv_flush;   // lines to write, or stop
+    condition_variable cv_space;   // room in the ring
+    vector<string> ring;
+    size_t head, n;                 // oldest line and number of lines in the ring
+    bool stop;
+    thread flusher;
+
+    void flush_loop();
+};
+
+// parses error, warning, info or debug
+bool parse_log_level(const string& s, log_level* level);
+
+#endif
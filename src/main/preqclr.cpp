@@ -24,14 +24,27 @@
 #include <zlib.h>
 #include <stdio.h>
 #include <getopt.h>
+#include <sys/stat.h>
 
 #include <htslib/bgzf.h>
 #include <htslib/sam.h>
 #include <htslib/hts.h>
 
-#include "kseq.h"
 #include "readpaf/paf.h"
 #include "readpaf/sdict.h"
+#include "paf_reader.hpp"
+#include "overlap_cache.hpp"
+#include "overlap_filter.hpp"
+#include "fq_reader.hpp"
+#include "seq_stats.hpp"
+#include "dust.hpp"
+#include "pair_table.hpp"
+#include "json_writer.hpp"
+#include "summary.hpp"
+#include "metrics.hpp"
+#include "logger.hpp"
+#include "task_graph.hpp"
+#include "gfa_reader.hpp"
 
 #include "zstr.hpp"
 #include "strict_fstream.hpp"
@@ -43,14 +56,12 @@
 #include "rapidjson/filereadstream.h"
 #include "rapidjson/filewritestream.h"
 
-KSEQ_INIT(gzFile, gzread)
-
 #define VERSION "2.0"
 #define SUBPROGRAM "calculate"
 using namespace std;
 using namespace rapidjson;
 
-typedef PrettyWriter<StringBuffer> JSONWriter;
+typedef json_writer JSONWriter;
 typedef std::chrono::duration<float> fsec;
 
 namespace opt
@@ -59,6 +70,7 @@ namespace opt
     static string reads_file;
     static string paf_file;
     static string gfa_file = "";
+    static string bam_file = "reads-to-contigs.bam";
     static string sample_name;
     static unsigned int rlen_cutoff = 0;
     static unsigned int olen_cutoff = 0;
@@ -76,44 +88,62 @@ namespace opt
     static bool print_new_paf = false;
     static double min_iden = 0.05;
     static unsigned int min_match = 100;
+    static unsigned int threads = 1;
+    static bool compact = false;
+    static bool summary = false;
+    static unsigned int dust_window = 0;
+    static double sample_fraction = 0.3;
+    static uint64_t sample_seed = 0;
+    static string cache_file;
+    static string write_cache_file;
+    static string sweep;
+    static string resume_state;
+    static string state_file;
+    static string partial_file;
+    static bool merge = false;
+    static vector<string> merge_files;
+    static string metrics_file;
+    static log_level log_threshold = LOG_INFO;
+    static vector<double> ngx_x;
+    static vector<double> genome_sizes;
 }
 
-bool endFile = false;
+// threads of each pass over the input files; the passes that run at the
+// same time share --threads between them
+struct pass_threads
+{
+    unsigned int reads, paf, bam;
+};
+static pass_threads threads_of = { 1, 1, 1 };
+
+// PAF records read between progress lines of the debug log
+static const uint64_t PROGRESS_RECORDS = 10000000;
+
+// resource use of each stage, filled in as the stages run
+static run_metrics metrics;
+
+// log of the run, echoed to stdout with --verbose
+static logger run_log;
+
 void out(string o)
 {
-    // Let's handle the verbose option
-    // SO: https://stackoverflow.com/questions/10150468/how-to-redirect-cin-and-cout-to-files
-    string logfile = opt::sample_name + ".preqclr.log";
-    ofstream out;
-    out.open( logfile, ios::app );
-    out << o << "\n";
-    if ( opt::verbose == 1 ) {
-        cout << o << "\n";
-    }    
-    if (endFile) {
-        out.close();
-    }
+    run_log.write(LOG_INFO, o);
 }
 
 // runs pre and post timing functions
 // SO: https://stackoverflow.com/questions/18517266/template-functor-wrapper-that-can-return-a-void-or-non-void-value
+// stages can run at the same time, so the times are logged with the stage
 struct timer
 {
-    chrono::system_clock::time_point swc;
-    clock_t scpu;
-    timer()
+    timer(const char* stage)
     {
-        swc = chrono::system_clock::now();
-        scpu = clock();
+        metrics.start(stage);
     }
 
     ~timer()
     {
-        auto ewc = chrono::system_clock::now();     
-        auto ecpu = clock();
-        auto elapsedwc = ewc - swc;
-        auto elapsedcpu = (ecpu - scpu)/(double)CLOCKS_PER_SEC;
-        out("[+] Time elapsed: " + to_string(elapsedwc.count()) + "s, CPU time: "  + to_string(elapsedcpu) + "s");
+        const stage_metrics* s = metrics.finish();
+        out("[+] Time elapsed in " + s->name + ": " + to_string(s->wall_time) + "s, CPU time: "  + to_string(s->cpu_time) + "s");
     }
     timer(timer&) = delete;
     void operator = (timer&) = delete;
@@ -121,10 +151,12 @@ struct timer
 
 // times and executes any functions
 // SO: https://stackoverflow.com/questions/14297971/passing-any-function-as-a-template-parameter
-template<typename T, typename... Ts>
-auto timeit(T (*FUNC)(Ts...), Ts... args) -> decltype(FUNC(args...))
+// arguments are forwarded as they are given, so references are not copied
+// the metrics of the run are recorded under the name of the stage
+template<typename F, typename... Ts>
+auto timeit(const char* stage, F FUNC, Ts&&... args) -> decltype(FUNC(forward<Ts>(args)...))
 {
-    timer time;
+    timer time(stage);
     return FUNC(forward<Ts>(args)...);
 }
 
@@ -135,8 +167,15 @@ int main(int argc, char *argv[])
     parse_args(argc, argv);
 
     // clear any previous log files with same name
-    ofstream ofs;
-    ofs.open( opt::sample_name + ".preqclr.log", ofstream::out | ios::trunc );
+    // a partial without a sample name is logged next to the partial file
+    string logfile = opt::sample_name + ".preqclr.log";
+    if ( opt::sample_name.empty() ) {
+        logfile = opt::partial_file + ".log";
+    }
+    if ( !run_log.open(logfile, opt::log_threshold, opt::verbose == 1) ) {
+        fprintf(stderr, "ERROR: failed to open %s for writing.\n\n", logfile.c_str());
+        exit(EXIT_FAILURE);
+    }
 
     // begin timing
     // SO: https://stackoverflow.com/questions/11062804/measuring-the-runtime-of-a-c-code
@@ -145,51 +184,125 @@ int main(int argc, char *argv[])
     out("========================================================");
     out("Run preqclr calculate");
     out("========================================================");
+
+    // with --partial, the results of this shard are saved for --merge instead
+    if ( !opt::partial_file.empty() ) {
+        out("[ Writing partial results ]");
+        timeit("write_partial", write_partial);
+        write_prometheus();
+        out("[+] Resulting partial file: " + opt::partial_file);
+        run_log.close();
+        return 0;
+    }
     auto tot_start = chrono::system_clock::now();
     auto tot_start_cpu = clock();
 
     // start json object
-    StringBuffer s;
-    JSONWriter writer(s);
+    // the document is streamed to the preqclr file as it is built
+    string filename = opt::sample_name + ".preqclr";
+    FILE* preqclrFILE = fopen(filename.c_str(), "w");
+    if ( preqclrFILE == NULL ) {
+        fprintf(stderr, "ERROR: failed to open %s for writing.\n\n", filename.c_str());
+        exit(EXIT_FAILURE);
+    }
+    JSONWriter writer(preqclrFILE, !opt::compact);
 
     writer.StartObject();
-    writer.String("sample_name");
+    writer.Key("sample_name");
     writer.String(opt::sample_name.c_str());
-    out("[ Parse reads file ]");
-    auto fq_records = timeit(parse_fq, opt::reads_file, &writer);
- 
-    out("[ Parse PAF file ] ");
-    auto paf_records = timeit(parse_paf, &writer);
+    // results of the parsing passes are built once, then only read
+    qc_results results;
+    const qc_results& res = results;
+    // with --resume-state, the new reads and overlaps are added to those of the state
+    unique_ptr<qc_state> state = start_state();
+
+    // the passes over the input files run at the same time, and each
+    // calculation once the passes it needs are done; the stages write to
+    // the preqclr file in turn, in the order they are added
+    task_graph stages;
+    vector<pair<size_t, unique_ptr<JSONWriter>>> outputs;
+    auto add_stage = [&](const vector<size_t>& deps, function<void(JSONWriter*)> f) {
+        JSONWriter* w = new JSONWriter(&writer);
+        size_t id = stages.add([=]() { f(w); }, deps);
+        outputs.push_back(make_pair(id, unique_ptr<JSONWriter>(w)));
+        return id;
+    };
+    int genome_size_est = 0;
+    unsigned int n_passes = share_threads(state != NULL, !opt::gfa_file.empty());
+
+    size_t reads = add_stage({}, [&](JSONWriter* w) {
+        out("[ Parse reads file ]");
+        results.fq_records = timeit("parse_reads", parse_fq, opt::reads_file, w, state.get());
+    });
+    // both passes add to the state, and the PAF pass saves it
+    vector<size_t> paf_deps;
+    if ( state ) {
+        paf_deps.push_back(reads);
+    }
+    size_t paf = add_stage(paf_deps, [&](JSONWriter* w) {
+        out("[ Parse PAF file ] ");
+        results.paf_records = timeit("parse_paf", parse_paf, w, &results.sweep, state.get());
+        state.reset();
+    });
 
     // start calculations
-    out("[ Writing read length distribution ]");
-    timeit(write_read_length, fq_records, &writer);
-
-    out("[ Calculating est cov per read and est genome size ]");
-    int genome_size_est = timeit(calculate_est_cov_and_est_genome_size, paf_records, &writer);
-
-    out("[ Calculating GC-content per read ]");
-    timeit(calculate_GC_content, fq_records, &writer);
-
-    out("[ Calculating total number of bases vs min read length ]");
-    timeit(calculate_tot_bases, paf_records, &writer);
+    add_stage({ reads }, [&](JSONWriter* w) {
+        out("[ Writing read length distribution ]");
+        timeit("read_length", write_read_length, res.fq_records, w);
+    });
+    size_t genome_size = add_stage({ paf }, [&](JSONWriter* w) {
+        out("[ Calculating est cov per read and est genome size ]");
+        genome_size_est = timeit("genome_size", calculate_est_cov_and_est_genome_size, res.paf_records, w);
+    });
+    if ( !opt::sweep.empty() ) {
+        add_stage({ paf }, [&](JSONWriter* w) {
+            out("[ Writing filter sweep ]");
+            timeit("sweep", write_sweep, res.sweep, w);
+        });
+    }
+    add_stage({ reads }, [&](JSONWriter* w) {
+        out("[ Calculating GC-content per read ]");
+        timeit("gc_content", calculate_GC_content, res.fq_records, w);
+    });
+    add_stage({ paf }, [&](JSONWriter* w) {
+        out("[ Calculating total number of bases vs min read length ]");
+        timeit("total_bases", calculate_tot_bases, res.paf_records, w);
+    });
+    add_stage({ reads }, [&](JSONWriter* w) {
+        out("[ Calculating total number of bases vs min read length of the reads file ]");
+        timeit("total_bases_reads", calculate_tot_bases_fq, res.fq_records, w);
+    });
 
     if ( !opt::gfa_file.empty() ) {
         // still testing: calc a-stat
-        auto contigs = calculate_ctgs();
-
-        out("[ Parse GFA file ] ");
-        timeit(parse_gfa, contigs);
-
-        out("[ Calculating NGX ]");
-        timeit(calculate_ngx, contigs, (double)genome_size_est, &writer);
-
-        out("[ Calculating repetitivity ]");
-        timeit(calculate_repetitivity, contigs, (double)genome_size_est, (int)paf_records.size(), &writer);
+        size_t contigs = stages.add([&]() {
+            out("[ Reading contigs ]");
+            results.contigs = timeit("contigs", calculate_ctgs);
+        }, {});
+        size_t gfa = stages.add([&]() {
+            out("[ Parse GFA file ] ");
+            timeit("parse_gfa", parse_gfa, &results.contigs);
+        }, { contigs });
+        add_stage({ gfa, genome_size }, [&](JSONWriter* w) {
+            out("[ Calculating NGX ]");
+            timeit("ngx", calculate_ngx, res.contigs, (double)genome_size_est, w);
+        });
+        add_stage({ gfa, genome_size, paf }, [&](JSONWriter* w) {
+            out("[ Calculating repetitivity ]");
+            timeit("repetitivity", calculate_repetitivity, res.contigs, (double)genome_size_est, (int)res.paf_records.size(), w);
+        });
     }
 
-    // convert JSON document to string and print
-    string filename = opt::sample_name + ".preqclr";
+    // with one thread, the stages run one after another in the order added;
+    // the passes start their own readers, so there are no more stage
+    // threads than passes at the same time
+    stages.start(min(opt::threads, n_passes));
+    for ( auto& o : outputs ) {
+        o.second->release();
+        stages.wait(o.first);
+        o.second->drain();
+    }
+    stages.finish();
 
     // wrap it up
     out("[ Done ]");
@@ -199,17 +312,19 @@ int main(int argc, char *argv[])
     fsec tot_elapsed = tot_end - tot_start;
     double tot_elapsed_cpu = (tot_end_cpu - tot_start_cpu)/(double)CLOCKS_PER_SEC;
 
+    writer.Key("metrics");
+    metrics.write(&writer);
     writer.Key("tot_cpu_time");
     writer.Double(tot_elapsed_cpu);
 
     writer.EndObject();
-    ofstream preqclrFILE;
-    preqclrFILE.open( filename );
-    preqclrFILE << s.GetString() << endl;
-    preqclrFILE.close();
+    writer.Flush();
+    fputc('\n', preqclrFILE);
+    fclose(preqclrFILE);
+    write_prometheus();
 
-    endFile = true;
     out("[+] Total time: " + to_string(tot_elapsed.count()) + "s, CPU time: " + to_string(tot_elapsed_cpu) + "s");
+    run_log.close();
 }
 
 void parse_args ( int argc, char *argv[])
@@ -217,7 +332,7 @@ void parse_args ( int argc, char *argv[])
     // getopt
     extern char *optarg;
     extern int optind, optopt;
-    const char* const short_opts = ":g:c:hvr:n:p:";
+    const char* const short_opts = ":g:c:hvr:n:p:t:";
     const option long_opts[] = {
         {"verbose",             no_argument,        NULL,   'v'},
         {"version",             no_argument,        NULL,   OPT_VERSION},
@@ -225,6 +340,7 @@ void parse_args ( int argc, char *argv[])
         {"sample_name",         required_argument,  NULL,   'n'},
         {"paf",                 required_argument,  NULL,   'p'},
         {"gfa",                 required_argument,  NULL,   'g'},
+        {"threads",             required_argument,  NULL,   't'},
         {"help",                no_argument,        NULL,   'h'},
         {"min-rlen",            required_argument,  NULL,   'l'},
         {"min-olen",            required_argument,  NULL,   'm'},
@@ -239,6 +355,23 @@ void parse_args ( int argc, char *argv[])
         {"print-read-cov",      no_argument,        NULL,   OPT_PRINT_READ_COV},
         {"print-gse-stat",      no_argument,        NULL,   OPT_PRINT_GSE_STAT},
         {"print-new-paf",		no_argument,		NULL,	OPT_PRINT_NEW_PAF},
+        {"compact",             no_argument,        NULL,   OPT_COMPACT},
+        {"summary",             no_argument,        NULL,   OPT_SUMMARY},
+        {"dust-window",         required_argument,  NULL,   OPT_DUST_WINDOW},
+        {"sample-fraction",     required_argument,  NULL,   OPT_SAMPLE_FRACTION},
+        {"sample-seed",         required_argument,  NULL,   OPT_SAMPLE_SEED},
+        {"cache",               required_argument,  NULL,   OPT_CACHE},
+        {"write-cache",         required_argument,  NULL,   OPT_WRITE_CACHE},
+        {"sweep",               required_argument,  NULL,   OPT_SWEEP},
+        {"resume-state",        required_argument,  NULL,   OPT_RESUME_STATE},
+        {"save-state",          required_argument,  NULL,   OPT_SAVE_STATE},
+        {"partial",             required_argument,  NULL,   OPT_PARTIAL},
+        {"merge",               no_argument,        NULL,   OPT_MERGE},
+        {"metrics",             required_argument,  NULL,   OPT_METRICS},
+        {"bam",                 required_argument,  NULL,   OPT_BAM},
+        {"log-level",           required_argument,  NULL,   OPT_LOG_LEVEL},
+        {"ngx",                 required_argument,  NULL,   OPT_NGX},
+        {"genome-size",         required_argument,  NULL,   OPT_GENOME_SIZE},
         { NULL, 0, NULL, 0 }
     };
 
@@ -250,17 +383,29 @@ void parse_args ( int argc, char *argv[])
 
     static const char* PREQCLR_CALCULATE_USAGE_MESSAGE =
     "usage: preqclr [OPTIONS] --sample_name ecoli --reads reads.fa --paf overlaps.paf --gfa layout.gfa \n"
+    "       preqclr [OPTIONS] --partial shard1.part --reads reads1.fa --paf shard1.paf\n"
+    "       preqclr [OPTIONS] --merge --sample_name ecoli shard1.part shard2.part ...\n"
     "Calculate quality statistics\n"
     "\n"
     "    -v, --verbose              Display verbose output\n"
     "        --version              Display version\n"
     "    -r, --reads                Fasta, fastq, fasta.gz, or fastq.gz files containing reads\n"
     "    -n, --sample_name          Sample name; we recommend using the name of species for example\n" 
-    "                               This will be used as output prefix\n"
-    "    -p, --paf                  Minimap2 Pairwise mApping Format (PAF) file \n"
+    "                               This will be used as output prefix; optional with --partial\n"
+    "    -p, --paf                  Minimap2 Pairwise mApping Format (PAF) file; use - to read from stdin \n"
     "                               This is produced using \'minimap2 -x ava-ont sample.fasta sample.fasta\'\n"
     "    -g, --gfa                  Miniasm Graph Fragment Assembly (GFA) file\n"
     "                               This file is produced using \'miniasm -f reads.fasta overlaps.paf\'\n"
+    "        --bam=FILE             BAM file of the reads aligned to the contigs of the GFA file, used\n"
+    "                               with -g; with a BAI or CSI index, the read counts come from the\n"
+    "                               index [reads-to-contigs.bam]\n"
+    "        --ngx=X[,X...]         Percentages of the genome size for the NGx and LGx of the contigs,\n"
+    "                               used with -g [0,1,2,...,100]\n"
+    "        --genome-size=SIZE[,SIZE...]\n"
+    "                               Also write the NGx, LGx and auNG against these genome sizes in bp,\n"
+    "                               used with -g\n"
+    "    -t, --threads=INT          Number of threads used to parse the reads and PAF files [1]\n"
+    "                               The passes over the files that run at the same time share them\n"
     "    -l, --min-rlen=INT         Use overlaps with read lengths >= INT [0]\n"
     "    -m, --min-olen=INT         Use overlaps longer than >=INT [0]\n"
     "    -i, --min-iden=INT         Use overlaps with minimum id [0.05]\n"
@@ -274,6 +419,42 @@ void parse_args ( int argc, char *argv[])
     "        --print-read-cov       Print read id and coverage for each read to stdout; overwrites verbose flag \n"
     "        --print-gse-stat       Print genome size estimate statistics only \n"
     "        --print-new-paf        Print new paf file after filtering overlaps\n"	
+    "        --compact              Write the preqclr file without indentation\n"
+    "        --summary              Write histograms and quantile sketches instead of every\n"
+    "                               value for the read length, GC content, DUST score,\n"
+    "                               overlap length, indel error rate and coverage distributions\n"
+    "        --dust-window=INT      Also write the fraction of each sampled read in INT bp windows\n"
+    "                               with a symmetric DUST score above 20 [0, off; 64 in the paper]\n"
+    "        --sample-fraction=FLOAT\n"
+    "                               Fraction of reads sampled for GC content and DUST scores [0.3]\n"
+    "                               Reads are picked by a hash of their name, so the same reads\n"
+    "                               are sampled in every run\n"
+    "        --sample-seed=INT      Seed of the read name hash used for sampling [0]\n"
+    "        --write-cache=FILE     Also write the overlaps of the PAF file, before filtering, to a\n"
+    "                               binary cache file that later runs can read with --cache\n"
+    "        --cache=FILE           Read the overlaps from a cache written with --write-cache\n"
+    "                               instead of a PAF file; any filter settings can be used\n"
+    "        --sweep=GRID           Also estimate genome size and coverage for every combination of\n"
+    "                               filter settings in GRID, in the same pass over the overlaps;\n"
+    "                               e.g. \"min-olen=0,500,1000;min-iden=0.05,0.1\". Keys are\n"
+    "                               min-iden, min-olen, min-rlen, min-match and keep-dups (0 or 1)\n"
+    "        --save-state=FILE      Save the reads and overlaps used to a state file, so that a later\n"
+    "                               run can report on them with new files without reading them again.\n"
+    "                               The whole state is written each time\n"
+    "        --resume-state=FILE    Report on the reads and PAF files together with those of a state\n"
+    "                               file saved with --save-state; only the new files are read, but\n"
+    "                               coverage and the report are calculated again over all of them.\n"
+    "                               -r is optional, for a state that only gets new overlaps\n"
+    "        --partial=FILE         Save the values of the reads file and the overlaps of the PAF file\n"
+    "                               that pass the filters to FILE instead of writing a report; -r is\n"
+    "                               optional, each reads file only needs to go to one partial\n"
+    "        --merge                Write the report of the partial files given as arguments, in order;\n"
+    "                               it is the same as for one run over all their reads and PAF files.\n"
+    "                               The filter and sampling settings must be those of the partials\n"
+    "        --metrics=FILE         Also write the metrics of each stage (time, memory, input read,\n"
+    "                               records filtered) to FILE in Prometheus text format\n"
+    "        --log-level=LEVEL      Lines written to the log: error, warning, info or debug [info];\n"
+    "                               debug adds progress while the PAF file is read\n"
     "\n"
     "Report bugs to https://github.com/simpsonlab/preqclr/issues"
     "\n";
@@ -326,6 +507,14 @@ void parse_args ( int argc, char *argv[])
             gflag = 1;
             arg >> opt::gfa_file;
             break;
+        case 't':
+            arg >> opt::threads;
+            if ( opt::threads < 1 ) {
+                fprintf(stderr, "preqclr: invalid value for --threads. Must be at least 1. \n\n");
+                fprintf(stderr, PREQCLR_CALCULATE_USAGE_MESSAGE, argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
         case 'h':
             cout << PREQCLR_CALCULATE_USAGE_MESSAGE << endl;
             exit(0);
@@ -378,6 +567,83 @@ void parse_args ( int argc, char *argv[])
         case OPT_PRINT_NEW_PAF:
             opt::print_new_paf = true;
             break;
+        case OPT_COMPACT:
+            opt::compact = true;
+            break;
+        case OPT_SUMMARY:
+            opt::summary = true;
+            break;
+        case OPT_DUST_WINDOW:
+            arg >> opt::dust_window;
+            break;
+        case OPT_SAMPLE_FRACTION:
+            arg >> opt::sample_fraction;
+            if ( opt::sample_fraction > 1 || opt::sample_fraction < 0 ) {
+                fprintf(stderr, "preqclr: invalid value for --sample-fraction. Must be between 0 and 1. \n\n");
+                fprintf(stderr, PREQCLR_CALCULATE_USAGE_MESSAGE, argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case OPT_SAMPLE_SEED:
+            arg >> opt::sample_seed;
+            break;
+        case OPT_CACHE:
+            arg >> opt::cache_file;
+            break;
+        case OPT_WRITE_CACHE:
+            arg >> opt::write_cache_file;
+            break;
+        case OPT_SWEEP:
+            opt::sweep = optarg;
+            // checks the grid before any file is read
+            parse_sweep(opt::sweep, make_overlap_config());
+            break;
+        case OPT_RESUME_STATE:
+            arg >> opt::resume_state;
+            break;
+        case OPT_SAVE_STATE:
+            arg >> opt::state_file;
+            break;
+        case OPT_PARTIAL:
+            arg >> opt::partial_file;
+            break;
+        case OPT_MERGE:
+            opt::merge = true;
+            break;
+        case OPT_METRICS:
+            arg >> opt::metrics_file;
+            break;
+        case OPT_BAM:
+            arg >> opt::bam_file;
+            break;
+        case OPT_NGX:
+            if ( !parse_values(optarg, &opt::ngx_x) ) {
+                fprintf(stderr, "preqclr: invalid value for --ngx. Must be a list of percentages between 0 and 100. \n\n");
+                fprintf(stderr, PREQCLR_CALCULATE_USAGE_MESSAGE, argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            for ( auto const& x : opt::ngx_x ) {
+                if ( x < 0 || x > 100 ) {
+                    fprintf(stderr, "preqclr: invalid value for --ngx. Must be a list of percentages between 0 and 100. \n\n");
+                    fprintf(stderr, PREQCLR_CALCULATE_USAGE_MESSAGE, argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+            }
+            break;
+        case OPT_GENOME_SIZE:
+            if ( !parse_values(optarg, &opt::genome_sizes) ) {
+                fprintf(stderr, "preqclr: invalid value for --genome-size. Must be a list of sizes in bp. \n\n");
+                fprintf(stderr, PREQCLR_CALCULATE_USAGE_MESSAGE, argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case OPT_LOG_LEVEL:
+            if ( !parse_log_level(optarg, &opt::log_threshold) ) {
+                fprintf(stderr, "preqclr: invalid value for --log-level. Must be error, warning, info or debug. \n\n");
+                fprintf(stderr, PREQCLR_CALCULATE_USAGE_MESSAGE, argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
         case '?':
             // invalid option: getopt_long already printed an error message
             if (optopt == 'c') {
@@ -388,6 +654,12 @@ void parse_args ( int argc, char *argv[])
             break;
         }
     }
+    // the arguments left are the partials to merge
+    if ( opt::merge ) {
+        while ( optind < argc ) {
+            opt::merge_files.push_back(argv[optind++]);
+        }
+    }
    if (optind < argc) {
         printf("WARNING: invalid option thus ignored: ");
         while (optind < argc)
@@ -410,6 +682,45 @@ void parse_args ( int argc, char *argv[])
     }
 
     // check mandatory variables and assign defaults
+    threads_of = { opt::threads, opt::threads, opt::threads };
+    if ( opt::ngx_x.empty() ) {
+        for ( int x = 0; x <= 100; x++ ) {
+            opt::ngx_x.push_back(x);
+        }
+    }
+    if ( opt::merge ) {
+        if ( rflag == 1 || pflag == 1 || !opt::cache_file.empty() || !opt::partial_file.empty() ) {
+            fprintf(stderr, "preqclr: --merge reads partial files, it cannot be used with -r,--reads, -p,--paf, --cache or --partial\n\n");
+            fprintf(stderr, PREQCLR_CALCULATE_USAGE_MESSAGE);
+            exit(EXIT_FAILURE);
+        }
+        if ( opt::merge_files.empty() ) {
+            fprintf(stderr, "preqclr: missing partial files to --merge\n\n");
+            fprintf(stderr, PREQCLR_CALCULATE_USAGE_MESSAGE);
+            exit(EXIT_FAILURE);
+        }
+        rflag = pflag = 1;
+    }
+    if ( !opt::partial_file.empty() ) {
+        if ( pflag == 0 ) {
+            fprintf(stderr, "preqclr: --partial needs a -p,--paf file\n\n");
+            fprintf(stderr, PREQCLR_CALCULATE_USAGE_MESSAGE);
+            exit(EXIT_FAILURE);
+        }
+        // -n is optional too, the sample is named when the partials are merged
+        rflag = nflag = 1;
+    }
+    // a resumed state may only get new overlaps
+    if ( !opt::resume_state.empty() ) {
+        rflag = 1;
+    }
+    if ( (!opt::partial_file.empty() || opt::merge) &&
+         (!opt::cache_file.empty() || !opt::write_cache_file.empty() || !opt::sweep.empty() ||
+          !opt::resume_state.empty() || !opt::state_file.empty()) ) {
+        fprintf(stderr, "preqclr: --partial and --merge cannot be used with --cache, --write-cache, --sweep, --resume-state or --save-state\n\n");
+        fprintf(stderr, PREQCLR_CALCULATE_USAGE_MESSAGE);
+        exit(EXIT_FAILURE);
+    }
     if ( rflag == 0 ) {
         fprintf(stderr, "preqclr: missing -r,--reads option\n\n");
         fprintf(stderr, PREQCLR_CALCULATE_USAGE_MESSAGE, argv[0]);
@@ -420,352 +731,635 @@ void parse_args ( int argc, char *argv[])
         fprintf(stderr, PREQCLR_CALCULATE_USAGE_MESSAGE);
         exit(EXIT_FAILURE);
     }
-    if ( pflag == 0 ) {
+    if ( pflag == 0 && opt::cache_file.empty() ) {
         fprintf(stderr, "preqclr: missing -p,--paf option\n\n");
         fprintf(stderr, PREQCLR_CALCULATE_USAGE_MESSAGE);
         exit(EXIT_FAILURE);
     }
+    if ( pflag == 1 && !opt::cache_file.empty() ) {
+        fprintf(stderr, "preqclr: -p,--paf and --cache cannot be used together\n\n");
+        fprintf(stderr, PREQCLR_CALCULATE_USAGE_MESSAGE);
+        exit(EXIT_FAILURE);
+    }
+    if ( !opt::write_cache_file.empty() && !opt::cache_file.empty() ) {
+        fprintf(stderr, "preqclr: --write-cache needs a PAF file, not --cache\n\n");
+        fprintf(stderr, PREQCLR_CALCULATE_USAGE_MESSAGE);
+        exit(EXIT_FAILURE);
+    }
+    if ( (!opt::resume_state.empty() || !opt::state_file.empty()) &&
+         (!opt::cache_file.empty() || !opt::write_cache_file.empty() || !opt::sweep.empty()) ) {
+        fprintf(stderr, "preqclr: --resume-state and --save-state cannot be used with --cache, --write-cache or --sweep\n\n");
+        fprintf(stderr, PREQCLR_CALCULATE_USAGE_MESSAGE);
+        exit(EXIT_FAILURE);
+    }
 
 };
 
-map<string, sequence> parse_paf(JSONWriter* writer)
+size_t estimate_num_overlaps(const string& file)
 {
-    /*
-    ========================================================
-    Parse PAF (in 2 passes)
-    --------------------------------------------------------
-    In first pass, we note which lines/overlaps in the PAF
-    file we don't want to include.
-    In second pass, we read all "good" lines/overlaps and
-    perform necessary calculations (like cov, read length)
-    Input:    PAF file
-    Output:   Dictionary: (each entry is a read)
-              key = read id
-              value = read (cov, length)
-    ========================================================
-    */  
-
-    // PASS 1: note overlaps we do not want
-    const char *c1 = opt::paf_file.c_str();
-    paf_file_t *fp1;
-    paf_rec_t r1;
-    fp1 = paf_open(c1);
-    if (!fp1) {
-        fprintf(stderr, "ERROR: PAF file failed to open. Check to see if it exists, is readable, and is non-empty.\n\n");
-        exit(EXIT_FAILURE);
+    // rough number of overlaps in the PAF file from its size, used to
+    // pre-size tables; PAF lines are ~100 bytes, gzip shrinks them ~4x
+    struct stat st;
+    if ( file.empty() || file == "-" || stat(file.c_str(), &st) != 0 || !S_ISREG(st.st_mode) ) {
+        return 0;
     }
+    size_t n = st.st_size / 100;
+    if ( file.size() > 3 && file.compare(file.size() - 3, 3, ".gz") == 0 ) {
+        n *= 4;
+    }
+    return n;
+}
 
-    // initialize overlap info
-    string qname, tname;
-    unsigned int qlen, qstart, qend, tlen, tstart, tend, strand, match, al;
-    
-    // we need to filter overlaps
-    // store all the lines we do not
-    vector<int> badlines;
-    // store hashed query read name + target read name pairs with line number
-    // and alignment length
-    map<size_t, pair<int, int>> h;
-    // current line number
-    int ln1 = 0; 
-    // store reads in paf_records: key = read id, value = read
-    map<string, sequence> paf_records;
-    writer->Key("indel_error_rates");
-    writer->StartArray();
-    while (paf_read(fp1, &r1) >= 0) {
-        qname = r1.qn,  qlen = r1.ql, qstart = r1.qs, qend = r1.qe; 
-        tname = r1.tn, tlen = r1.tl, tstart = r1.ts, tend = r1.te;
-        match = r1.ml, al = r1.bl;
-        double al_id = (double)match/(double)al;
-
-        // start filtering overlaps
-        // remove self overlaps
-        if ( qname.compare(tname) == 0) { 
-            //self-overlap: query read == target read
-            badlines.push_back(ln1);
-            ln1++;
-            continue;
-        }
+overlap_config make_overlap_config()
+{
+    // filters that only depend on the overlap itself
+    overlap_config c;
+    c.filter.min_iden = opt::min_iden;
+    c.filter.min_match = opt::min_match;
+    c.filter.min_olen = opt::olen_cutoff;
+    c.filter.min_rlen = opt::rlen_cutoff;
+    c.filter.max_indel_rate = 0.3;
+    c.keep_dups = opt::keep_dups;
+    c.rlen_cutoff = opt::rlen_cutoff;
+    return c;
+}
 
-        // remove overlaps with low match id, length below cutoff
-        if ( al_id < opt::min_iden || match < opt::min_match || al < opt::olen_cutoff || qlen < opt::rlen_cutoff || tlen < opt::rlen_cutoff ) {
-            badlines.push_back(ln1);
-            ln1++;
-            continue;
+bool parse_values(const string& list, vector<double>* values)
+{
+    // values separated by ',', all of them >= 0
+    values->clear();
+    stringstream ss(list);
+    string item;
+    while ( getline(ss, item, ',') ) {
+        istringstream arg(item);
+        double v;
+        if ( !(arg >> v) || !arg.eof() || v < 0 ) {
+            return false;
         }
+        values->push_back(v);
+    }
+    return !values->empty();
+}
 
-        // remove overlaps with high indel error rate
-        int omax = max(qend - qstart, tend - tstart); 
-        int omin = min(qend - qstart, tend - tstart);
-        if ( (1 - double(omin)/omax) > 0.3 ) {
-            badlines.push_back(ln1);
-            ln1++;
+vector<overlap_config> parse_sweep(const string& spec, const overlap_config& base)
+{
+    // spec is a list of key=values, separated by ';', with the values
+    // separated by ','; every combination of the values is used, the
+    // settings not in the list are those of the command line
+    vector<overlap_config> configs(1, base);
+    stringstream ss(spec);
+    string item;
+    while ( getline(ss, item, ';') ) {
+        if ( item.empty() ) {
             continue;
         }
-
-        // remove duplicate overlaps
-        if ( !opt::keep_dups ) {
-            // create a hashkey with lexicographically smallest combination of read names
-            size_t hashkey = min(hash<string>{}(qname + tname), hash<string>{}(tname + qname));
-            // check if we've seen this overlap between these two reads before
-            auto it = h.find(hashkey);
-            if (it != h.end()) {
-                // YES, duplicate detected
-                // compare the length of overlaps to get longer overlap.
-                int curr_aln_len = int(r1.bl);
-                int curr_ln = ln1;
-                int prev_aln_len = int(it->second.first);
-                int prev_ln = int(it->second.second);
-                if ( curr_aln_len > prev_aln_len ) {
-                    // prev. overlap between these 2 reads is shorter, we use the current line instead
-                    // prev. overlap's line number is recorded as "bad"
-                    badlines.push_back(prev_ln);
-                    h[hashkey] = make_pair(curr_aln_len, curr_ln);
-                    ln1++;
-                    continue;
-                    //cout << qname << "\t" << tname << "\t" << prev_ln << "\n";
+        size_t eq = item.find('=');
+        string key = item.substr(0, eq);
+        if ( eq == string::npos || eq + 1 == item.size() ) {
+            fprintf(stderr, "preqclr: invalid --sweep item %s. Must be key=value[,value...]. \n\n", item.c_str());
+            exit(EXIT_FAILURE);
+        }
+        vector<string> values;
+        stringstream vs(item.substr(eq + 1));
+        string v;
+        while ( getline(vs, v, ',') ) {
+            values.push_back(v);
+        }
+        // earlier keys vary slowest
+        vector<overlap_config> next;
+        for ( auto const& base_config : configs ) {
+            for ( auto const& v : values ) {
+                overlap_config c = base_config;
+                istringstream arg(v);
+                bool ok;
+                if ( key == "min-iden" ) {
+                    ok = bool(arg >> c.filter.min_iden) && c.filter.min_iden >= 0 && c.filter.min_iden <= 1;
+                } else if ( key == "min-olen" ) {
+                    ok = bool(arg >> c.filter.min_olen);
+                } else if ( key == "min-rlen" ) {
+                    ok = bool(arg >> c.filter.min_rlen);
+                    c.rlen_cutoff = c.filter.min_rlen;
+                } else if ( key == "min-match" ) {
+                    ok = bool(arg >> c.filter.min_match);
+                } else if ( key == "keep-dups" ) {
+                    ok = bool(arg >> c.keep_dups);
                 } else {
-                    badlines.push_back(curr_ln);
-                    ln1++;
-                    continue;
-                    //cout << qname << "\t" << tname << "\t" <<curr_ln << "\n";
+                    fprintf(stderr, "preqclr: invalid --sweep key %s. Must be one of min-iden, min-olen, min-rlen, min-match, keep-dups. \n\n", key.c_str());
+                    exit(EXIT_FAILURE);
                 }
-            } else {
-                // First time we've seen this pair
-                int aln_len = int(r1.bl);
-                h.insert(make_pair(hashkey, make_pair(aln_len, ln1)));
+                if ( !ok ) {
+                    fprintf(stderr, "preqclr: invalid --sweep value %s for %s. \n\n", v.c_str(), key.c_str());
+                    exit(EXIT_FAILURE);
+                }
+                next.push_back(c);
             }
         }
+        configs.swap(next);
+    }
+    return configs;
+}
 
-        // adjust read length: read length = the region of read with overlaps only
-        // store region with overlap on read and init read in paf_records
-        auto i = paf_records.find(qname);
-        bool success = true;
-        if ( i == paf_records.end() ) {
-            // if read not found initialize in paf_records
-            sequence qr;
-            qr.set(qlen, 0, qstart, qend);
-            // cout << qname << "\t" << qr.min_s << "\t" << qr.max_e << "\n";
-            paf_records.insert(pair<string,sequence>(qname, qr));
-        } else {
-            // if read found, update the overlap info
-            success = i->second.updateOvlpRgn(qstart, qend);
-            // cout << qname << "\t" << i->second.min_s << "\t" << i->second.max_e << "\n";
+qc_settings current_settings()
+{
+    qc_settings s;
+    s.config = make_overlap_config();
+    s.sample_fraction = opt::sample_fraction;
+    s.sample_seed = opt::sample_seed;
+    s.dust_window = opt::dust_window;
+    return s;
+}
+
+unique_ptr<qc_state> start_state()
+{
+    // state of this run, holding the reads and overlaps of the state resumed
+    unique_ptr<qc_state> state;
+    if ( opt::resume_state.empty() && opt::state_file.empty() ) {
+        return state;
+    }
+    state.reset(new qc_state());
+    state->settings = current_settings();
+    if ( !opt::resume_state.empty() ) {
+        qc_state saved;
+        if ( !load_state(opt::resume_state, &saved) ) {
+            fprintf(stderr, "ERROR: state file failed to open. Check to see if it exists and was saved with --save-state by this version of preqclr.\n\n");
+            exit(EXIT_FAILURE);
         }
-        auto j = paf_records.find(tname);
-        if ( i == paf_records.end() ) {
-            // if read not found initialize in paf_records
-            sequence tr;
-            tr.set(tlen, 0, tstart, tend);
-            paf_records.insert(pair<string,sequence>(tname, tr));
-        } else {
-            // if read found, update the overlap info
-            success = j->second.updateOvlpRgn(tstart, tend);
+        if ( !same_settings(state->settings, saved.settings) ) {
+            fprintf(stderr, "ERROR: the filter and sampling settings differ from those the state file was saved with.\n\n");
+            exit(EXIT_FAILURE);
         }
+        *state = move(saved);
+    }
+    return state;
+}
 
-        if ( !success ){
-            badlines.push_back(ln1);
-            double indel_error_rate = (1 - double(omin)/omax);
-            writer->Double(indel_error_rate);
-        } 
-        // next overlap, read next line!
-        ln1+=1;    
+qc_partial read_partial(const string& fn, bool with_overlaps)
+{
+    qc_partial p;
+    if ( !load_partial(fn, &p, with_overlaps) ) {
+        fprintf(stderr, "ERROR: partial file %s failed to open. Check to see if it exists and was written with --partial by this version of preqclr.\n\n", fn.c_str());
+        exit(EXIT_FAILURE);
     }
-    h.clear(); // free up memory
-    writer->EndArray();
-    sort(badlines.begin(), badlines.end());
+    if ( !same_settings(current_settings(), p.settings) ) {
+        fprintf(stderr, "ERROR: the filter and sampling settings differ from those the partial file %s was written with.\n\n", fn.c_str());
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
 
-    // PASS 2: read only good lines defined in PASS 1
-    paf_file_t *fp2;
-    fp2 = paf_open(c1);
-    if (!fp2) {
+void write_partial()
+{
+    // the overlaps are only filtered here, coverage needs the overlaps
+    // of all the partials
+    qc_partial p;
+    p.settings = current_settings();
+    if ( !opt::reads_file.empty() ) {
+        read_fq(opt::reads_file, &p.fq);
+    }
+    const overlap_filter& filter = p.settings.config.filter;
+    paf_reader reader(opt::paf_file, threads_of.paf, [&](const paf_record& r) { return int(filter.reason(r)); });
+    if (!reader.is_open()) {
         fprintf(stderr, "ERROR: PAF file failed to open. Check to see if it exists, is readable, and is non-empty.\n\n");
         exit(EXIT_FAILURE);
     }
-    int ln2 = 0; // index in PAF file
-    unsigned int iv = 0; // index in badlines vector
-    // the vector is sorted numerically
-    // we can loop through the vector once by storing which is the next line to avoid
-    // once we have reached this line, we can move on to the next bad line and
-    // look out for that one while going through the next lines
-    int bad;
-    if ( !badlines.empty() ) {
-        bad = int(badlines.at(iv)); // first bad line
-    } else {
-        bad = ln1; // no badlines detected, set to last line
+    paf_chunk* chunk;
+    while ( (chunk = reader.next()) != NULL ) {
+        for ( auto const& r : chunk->records ) {
+            p.add(r);
+        }
+        reader.release(chunk);
     }
+    add_filter_metrics(&reader, NULL);
+    if ( !save_partial(opt::partial_file, p) ) {
+        fprintf(stderr, "ERROR: failed to write the partial file %s.\n\n", opt::partial_file.c_str());
+        exit(EXIT_FAILURE);
+    }
+}
 
-    // find min overlap length
-    double mino = 100000;
+void add_filter_metrics(paf_reader* reader, const uint64_t* dropped)
+{
+    // the reader input and overlaps dropped by the reader and after it
+    stage_metrics& stage = metrics.current();
+    if ( reader != NULL ) {
+        stage.add(reader->metrics());
+    }
+    for ( int i = FILTER_KEEP + 1; i < N_FILTER_REASONS; i++ ) {
+        uint64_t n = (reader != NULL ? reader->n_dropped(i) : 0) + (dropped != NULL ? dropped[i] : 0);
+        stage.add_filtered(filter_reason_name(i), n);
+    }
+}
 
-    // write overlap lengths to JSON
-    writer->Key("overlap_lengths");
-    writer->StartArray();
+void add_engine_metrics(const overlap_engine& engine)
+{
+    stage_metrics& stage = metrics.current();
+    stage.add_filtered("duplicate", engine.n_duplicates);
+    stage.add_filtered("off_region", engine.n_off_region);
+    stage.add_filtered("trimmed", engine.n_trimmed);
+}
 
-    // read good lines in PAF
-    while (paf_read(fp2, &r1) >= 0) { 
-        if ( ln2 < bad ) {
-            // read each line/overlap and save each column into variable
-            qname = r1.qn,  qlen = r1.ql, qstart = r1.qs, qend = r1.qe;
-            tname = r1.tn, tlen = r1.tl, tstart = r1.ts, tend = r1.te;
-            match = r1.ml, al = r1.bl, strand = r1.rev;
-            auto i = paf_records.find(qname);
-            auto j = paf_records.find(tname);
-            unsigned int qalen = i->second.max_e - i->second.min_s;
-            unsigned int talen = j->second.max_e - j->second.min_s;
-            // remove reads where the new length <<<< original length
-            if ( qalen > opt::rlen_cutoff && talen > opt::rlen_cutoff && double(tlen-talen)/tlen < 0.10 && double(qlen-qalen)/qlen < 0.10  ) {
-                if ( opt::print_new_paf) {
-                    string s = ( strand == 0 ) ? "-" : "+";
-                    cout << qname << "\t" << qalen << "\t" << qstart << "\t" << qend << "\t" << s <<"\t" << tname << "\t" << talen << "\t" << tstart << "\t" << tend << "\t" << r1.ml << "\t"<< r1.bl << "\t255\n";
-                }
+unsigned int share_threads(bool sequential, bool with_bam)
+{
+    // the reads and PAF passes run one after the other with a state, and
+    // the BAM pass runs next to them; the PAF pass, usually the largest,
+    // gets the threads left over
+    unsigned int n = opt::threads;
+    unsigned int passes = (sequential ? 1 : 2) + (with_bam ? 1 : 0);
+    unsigned int share = max(1u, n / passes);
+    threads_of.paf = n > share * (passes - 1) ? n - share * (passes - 1) : 1;
+    threads_of.reads = sequential ? threads_of.paf : share;
+    threads_of.bam = share;
+    return passes;
+}
+
+void write_prometheus()
+{
+    if ( opt::metrics_file.empty() ) {
+        return;
+    }
+    const string& sample = opt::sample_name.empty() ? opt::partial_file : opt::sample_name;
+    if ( !metrics.write_prometheus(opt::metrics_file, sample) ) {
+        fprintf(stderr, "ERROR: failed to write the metrics file %s.\n\n", opt::metrics_file.c_str());
+        exit(EXIT_FAILURE);
+    }
+}
+
+read_table parse_paf(JSONWriter* writer, vector<sweep_result>* sweep, qc_state* state)
+{
+    /*
+    ========================================================
+    Parse PAF (in a single pass)
+    --------------------------------------------------------
+    While reading the PAF file we filter the overlaps and
+    keep a compact record of each overlap we may use,
+    together with the region of each read covered by
+    overlaps. Once the file is read, we use the kept
+    records to perform the necessary calculations (like
+    cov, read length). The file is only read once, so it
+    can also be a pipe or stdin ("-").
+    With --sweep, each configuration of the sweep keeps
+    its own overlaps and read table in the same pass.
+    Input:    PAF file
+    Output:   Table of reads, indexed by read id
+              (read name, cov, length)
+    ========================================================
+    */  
 
-                // calculate softclipped regions 
-                // adjust to new read length (region with overlaps only)
-                unsigned int qprefix_len = qstart - i->second.min_s;
-                unsigned int qsuffix_len = i->second.max_e - qend;
-                unsigned int tprefix_len = tstart - j->second.min_s;
-                unsigned int tsuffix_len = j->second.max_e - tend;
-                int left_clip = 0, right_clip = 0;
-                if ( ( qstart != 0 ) && ( tstart !=0 )) {
-                    if ( strand == 0 ) { 
-                        left_clip += min(qprefix_len, tprefix_len);
-                    } else {
-                        left_clip += min(qprefix_len, tsuffix_len);
+    // configurations used: the one of the command line, then the sweep
+    vector<overlap_config> configs(1, make_overlap_config());
+    if ( !opt::sweep.empty() ) {
+        vector<overlap_config> s = parse_sweep(opt::sweep, configs[0]);
+        configs.insert(configs.end(), s.begin(), s.end());
+    }
+    size_t n_configs = configs.size();
+
+    // store reads in paf_records, read names are interned to read ids
+    read_table paf_records;
+    // the reads of the sweep configurations share the ids of sweep_ids
+    read_table sweep_ids;
+    vector<read_table> sweep_records(n_configs - 1);
+
+    size_t n_hint = !opt::cache_file.empty() ? 0 : estimate_num_overlaps(opt::paf_file);
+    vector<unique_ptr<overlap_engine>> engines;
+    auto start_engines = [&](size_t n_overlaps_hint) {
+        engines.emplace_back(new overlap_engine(configs[0], paf_records, n_overlaps_hint));
+        for ( size_t k = 1; k < n_configs; k++ ) {
+            // the sweep engines grow their tables as they fill, so a large
+            // grid does not reserve one table per point up front
+            engines.emplace_back(new overlap_engine(configs[k], sweep_records[k-1], 0));
+        }
+    };
+    distribution_writer indel_error_rates(writer, "indel_error_rates", histogram::linear(0.001), opt::summary);
+    // overlaps dropped by the filters of the command line here, rather than by a reader
+    uint64_t dropped[N_FILTER_REASONS] = { 0 };
+    if ( state != NULL ) {
+        // the rates of the state come first, as if its PAF files were read again
+        for ( auto const& r : state->indel_rates ) {
+            indel_error_rates.add(r);
+        }
+        indel_error_rates.tee(&state->indel_rates);
+        paf_records = move(state->reads);
+    }
+
+    if ( !opt::cache_file.empty() ) {
+        // overlaps are read from the columns of the cache and filtered
+        // in blocks, on worker threads with --threads
+        overlap_cache cache(opt::cache_file);
+        if ( !cache.is_open() ) {
+            fprintf(stderr, "ERROR: overlap cache failed to open. Check to see if it exists and was written with --write-cache by this version of preqclr.\n\n");
+            exit(EXIT_FAILURE);
+        }
+        const overlap_columns& c = cache.columns();
+        start_engines(c.n);
+        size_t n_read = 0;
+        chunk_pipeline<cache_block> blocks(threads_of.paf,
+            [&](cache_block* b) {
+                b->b = n_read;
+                b->e = min(n_read + CACHE_BLOCK_SIZE, c.n);
+                n_read = b->e;
+                return b->b < b->e;
+            },
+            [&](cache_block* b) {
+                // one run of flags per configuration
+                size_t l = b->e - b->b;
+                b->keep.resize(l * n_configs);
+                for ( size_t k = 0; k < n_configs; k++ ) {
+                    configs[k].filter.keep_range(c, b->b, b->e, b->keep.data() + k * l);
+                }
+            });
+        // ids of the cache are mapped to ids of paf_records as the reads are
+        // first used, so reads are numbered as they are from the PAF file;
+        // the sweep uses the ids of the cache
+        vector<uint32_t> ids(cache.n_reads(), UINT32_MAX);
+        auto table_id = [&](uint32_t id) {
+            if ( ids[id] == UINT32_MAX ) {
+                ids[id] = paf_records.intern(cache.name(id));
+            }
+            return ids[id];
+        };
+        for ( auto& t : sweep_records ) {
+            t.resize(cache.n_reads());
+        }
+        paf_record r1;
+        cache_block* b;
+        while ( (b = blocks.next()) != NULL ) {
+            size_t l = b->e - b->b;
+            for ( size_t i = b->b; i < b->e; i++ ) {
+                r1.ql = c.ql[i], r1.qs = c.qs[i], r1.qe = c.qe[i];
+                r1.tl = c.tl[i], r1.ts = c.ts[i], r1.te = c.te[i];
+                r1.ml = c.ml[i], r1.bl = c.bl[i], r1.rev = c.rev[i];
+                if ( b->keep[i - b->b] ) {
+                    // the query is interned first, as when the PAF file is read
+                    uint32_t qid = table_id(c.qid[i]);
+                    uint32_t tid = table_id(c.tid[i]);
+                    engines[0]->add(qid, tid, r1, &indel_error_rates);
+                } else {
+                    dropped[configs[0].filter.reason(c, i)]++;
+                }
+                for ( size_t k = 1; k < n_configs; k++ ) {
+                    if ( b->keep[k * l + i - b->b] ) {
+                        engines[k]->add(c.qid[i], c.tid[i], r1, NULL);
                     }
                 }
-                if ( ( qend != 0 ) && ( tend != 0 ) ){
-                    if ( strand == 0 ) {
-                        right_clip += min(qsuffix_len, tsuffix_len);
-                    } else {
-                        right_clip += min(qsuffix_len, tprefix_len);
-                    }     
+            }
+            blocks.release(b);
+        }
+        struct stat st;
+        input_metrics in = { 0, 0, c.n, blocks.busy_times(), blocks.cpu_time() };
+        if ( stat(opt::cache_file.c_str(), &st) == 0 ) {
+            in.bytes_read = in.bytes_uncompressed = st.st_size;
+        }
+        metrics.current().add(in);
+        add_filter_metrics(NULL, dropped);
+    } else if ( opt::merge ) {
+        // overlaps of the partials passed the filters when they were written;
+        // they are used partial by partial, as if their PAF files were read in turn
+        start_engines(0);
+        for ( auto const& fn : opt::merge_files ) {
+            qc_partial p = read_partial(fn, true);
+            // names of the partial are interned as the reads are first used
+            vector<uint32_t> ids(p.names.n_ids(), UINT32_MAX);
+            auto table_id = [&](uint32_t id) {
+                if ( ids[id] == UINT32_MAX ) {
+                    ids[id] = paf_records.intern(p.names.name(id));
                 }
-                int overhang = left_clip + right_clip;
-
-                // calculate coverage per read               
-                unsigned int qoverlap_len = abs(qend - qstart) + overhang;
-                double qcov = double(qoverlap_len) / double(qalen);
-                i->second.updateCov(qcov);
-                unsigned int toverlap_len = abs(tend - tstart) + overhang;
-                double tcov = double(toverlap_len) / double(talen); 
-                j->second.updateCov(tcov);
-
-                // track minimum overlap length used
-                if ( qcov < mino ) {
-                    mino = qcov;
+                return ids[id];
+            };
+            for ( size_t i = 0; i < p.overlaps.size(); i++ ) {
+                uint32_t qid = table_id(p.overlaps[i].qid);
+                uint32_t tid = table_id(p.overlaps[i].tid);
+                engines[0]->add(qid, tid, p.record(i), &indel_error_rates);
+            }
+            metrics.current().records += p.overlaps.size();
+        }
+    } else {
+        // overlaps are parsed and filtered by the reader, on worker threads with --threads
+        // with --write-cache or --sweep, more overlaps are kept and filtered here
+        unique_ptr<cache_writer> cache;
+        if ( !opt::write_cache_file.empty() ) {
+            cache.reset(new cache_writer(opt::write_cache_file));
+            if ( !cache->is_open() ) {
+                fprintf(stderr, "ERROR: failed to open %s for writing.\n\n", opt::write_cache_file.c_str());
+                exit(EXIT_FAILURE);
+            }
+        }
+        // returns the reason the overlaps no configuration keeps are dropped
+        // for by the filters of the command line
+        auto drop = [&](const paf_record& r) {
+            if ( cache ) {
+                return 0;
+            }
+            for ( size_t k = 1; k < n_configs; k++ ) {
+                if ( configs[k].filter.keep(r) ) {
+                    return 0;
                 }
-                if ( tcov < mino ) {
-                    mino = tcov;
+            }
+            return int(configs[0].filter.reason(r));
+        };
+        start_engines(n_hint);
+        if ( state != NULL ) {
+            engines[0]->restore(move(state->overlaps));
+        }
+        paf_reader reader(opt::paf_file, threads_of.paf, drop);
+        if (!reader.is_open()) {
+            fprintf(stderr, "ERROR: PAF file failed to open. Check to see if it exists, is readable, and is non-empty.\n\n");
+            exit(EXIT_FAILURE);
+        }
+        bool refilter = cache || n_configs > 1;
+        uint64_t n_seen = 0, next_progress = PROGRESS_RECORDS;
+        // chunks come back in file order, so the overlaps are used in the same
+        // order whatever the number of threads
+        paf_chunk* chunk;
+        while ( (chunk = reader.next()) != NULL ) {
+            for ( auto const& r1 : chunk->records ) {
+                if ( cache ) {
+                    cache->add(r1);
                 }
-
-                // write to JSON overlap info
-                writer->Int(qoverlap_len);
-                writer->Int(toverlap_len);
+                filter_reason reason = refilter ? configs[0].filter.reason(r1) : FILTER_KEEP;
+                if ( reason == FILTER_KEEP ) {
+                    uint32_t qid = paf_records.intern(r1.qn.s, r1.qn.l);
+                    uint32_t tid = paf_records.intern(r1.tn.s, r1.tn.l);
+                    engines[0]->add(qid, tid, r1, &indel_error_rates);
+                } else {
+                    dropped[reason]++;
+                }
+                uint32_t qid = UINT32_MAX, tid = UINT32_MAX;
+                for ( size_t k = 1; k < n_configs; k++ ) {
+                    if ( !configs[k].filter.keep(r1) ) {
+                        continue;
+                    }
+                    if ( qid == UINT32_MAX ) {
+                        qid = sweep_ids.intern(r1.qn.s, r1.qn.l);
+                        tid = sweep_ids.intern(r1.tn.s, r1.tn.l);
+                        for ( auto& t : sweep_records ) {
+                            t.resize(sweep_ids.n_ids());
+                        }
+                    }
+                    engines[k]->add(qid, tid, r1, NULL);
+                }
+            }
+            n_seen += chunk->n_lines;
+            if ( n_seen >= next_progress && run_log.enabled(LOG_DEBUG) ) {
+                run_log.write(LOG_DEBUG, "[-] " + to_string(n_seen) + " PAF records read");
+                next_progress = n_seen + PROGRESS_RECORDS;
             }
-        } else if ( iv < badlines.size()-1 ) {
-            // next bad line to look out for:
-            iv+=1;
-            bad = int(badlines.at(iv));
+            reader.release(chunk);
         }
-        ln2+=1;
+        if ( cache ) {
+            cache->finish();
+        }
+        add_filter_metrics(&reader, dropped);
     }
-    writer->EndArray();
+    indel_error_rates.finish();
+
+    // the state is saved before coverage is calculated, as more overlaps
+    // can change the regions of the reads
+    if ( !opt::state_file.empty() ) {
+        if ( !save_state(opt::state_file, *state, paf_records, engines[0]->kept()) ) {
+            fprintf(stderr, "ERROR: failed to write the state file %s.\n\n", opt::state_file.c_str());
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // write overlap lengths to JSON
+    distribution_writer overlap_lengths(writer, "overlap_lengths", histogram::log(100), opt::summary);
+    // find min overlap length
+    double mino = engines[0]->finish(&overlap_lengths, opt::print_new_paf);
+    overlap_lengths.finish();
+    add_engine_metrics(*engines[0]);
     if ( opt::print_read_cov ) {
-        for ( auto const& r : paf_records ) {
-            sequence temp = r.second;
-            cout << r.first << "\t" << temp.read_len << "\t" << temp.cov << "\n";
+        for ( uint32_t id = 0; id < paf_records.n_ids(); id++ ) {
+            if ( paf_records.init[id] ) {
+                cout << paf_records.name(id) << "\t" << paf_records.read_len[id] << "\t" << paf_records.cov[id] << "\n";
+            }
+        }
+    }
+
+    // summarise each sweep configuration, freeing its reads once done
+    for ( size_t k = 1; k < n_configs; k++ ) {
+        engines[k]->finish(NULL, false);
+        const read_table& t = sweep_records[k-1];
+        sweep_result r = { configs[k], engines[k]->n_used, estimate_genome_size(t, opt::keep_low_cov, opt::keep_high_cov), distribution(histogram::linear(1.0)) };
+        for ( uint32_t id = 0; id < t.n_ids(); id++ ) {
+            if ( t.init[id] ) {
+                r.cov.add(t.cov[id]);
+            }
         }
+        sweep->push_back(r);
+        engines[k].reset();
+        sweep_records[k-1] = read_table();
     }
    cout << "mino: " << mino << "\n";
    return paf_records;
 }
 
-vector<pair<double, int>> parse_fq(string file, JSONWriter* writer)
+void calculate_read_stats(fq_batch* b)
+{
+    // called from the reads reader worker threads
+    for ( size_t i = 0; i < b->size(); i++ ) {
+        if ( !b->sampled[i] ) {
+            continue;
+        }
+        const char* s = b->seq(i);
+        size_t r_len = b->len(i);
+        b->gc[i] = (double(count_gc(s, r_len)) / double(r_len)) * 100.0;
+        b->dust[i] = round(dust_score(s, r_len));
+        if ( opt::dust_window > 0 ) {
+            b->low_complexity[i] = dust_low_complexity(s, r_len, opt::dust_window);
+        }
+    }
+}
+
+void read_fq(const string& file, fq_values* fq)
 {
-    gzFile fp;
-    kseq_t *seq;
-    const char *c = file.c_str();
-    fp = gzopen(c, "r");
-    if (fp == 0) {
+    // GC content and DUST scores are calculated by the reader,
+    // on worker threads with --threads
+    fq_reader reader(file, threads_of.reads, calculate_read_stats, opt::sample_fraction, opt::sample_seed);
+    if ( !reader.is_open() ) {
         fprintf(stderr, "ERROR: reads file failed to open. Check to see if it exists, is readable, and is non-empty.\n\n");
         exit(EXIT_FAILURE);
     }
-    seq = kseq_init(fp);
-    vector<pair<double, int>> fq_records;
-    writer->Key("dust_scores");
-    writer->StartArray();
-    while (kseq_read(seq) >= 0) {
-         string id = seq->name.s;
-         string sequence = seq->seq.s;
-         int r_len = sequence.length();
-         int gc = 0;
-         // only read 40% of sequences
-         if (((rand() % 10) + 1) < 4) {
-             for ( int i=0; i<r_len; i++) {
-                 gc += sequence[i] == 'G' || sequence[i] == 'C';
-             }
-             double gc_cont = (double(gc) / double(r_len)) *100.0;
-             fq_records.push_back(make_pair(gc_cont, r_len));
-             auto ds = round(calculateDustScore(sequence));           
-             writer->Double(ds);
-         } else {
-             fq_records.push_back(make_pair(0, r_len));
-         }
+    // batches come back in file order, so the records are in read order
+    while ( fq_batch* b = reader.next() ) {
+        for ( size_t i = 0; i < b->size(); i++ ) {
+            int r_len = b->len(i);
+            if ( b->sampled[i] ) {
+                fq->records.push_back(make_pair(b->gc[i], r_len));
+                fq->dust_scores.push_back(b->dust[i]);
+                if ( opt::dust_window > 0 ) {
+                    fq->low_complexity.push_back(b->low_complexity[i]);
+                }
+            } else {
+                fq->records.push_back(make_pair(0, r_len));
+            }
+        }
+        reader.release(b);
     }
-    writer->EndArray();
-    kseq_destroy(seq);
-    gzclose(fp);
-    return fq_records;
+    metrics.current().add(reader.metrics());
 }
 
-void parse_gfa(map<string, contig> ctgs)
+vector<pair<double, int>> parse_fq(string file, JSONWriter* writer, qc_state* state)
 {
-    // parse gfa to get the contig lengths in MB
-    string line;
-    ifstream infile(opt::gfa_file);
-    if (!infile.is_open()) {
-        fprintf(stderr, "ERROR: GFA failed to open. Check to see if it exists, is readable, and is non-empty.\n\n");
-        exit(EXIT_FAILURE);
+    // the reads of the state come first, as if its reads files were read again
+    fq_values values;
+    fq_values& fq = state != NULL ? state->fq : values;
+    if ( opt::merge ) {
+        for ( auto const& fn : opt::merge_files ) {
+            qc_partial p = read_partial(fn, false);
+            fq.records.insert(fq.records.end(), p.fq.records.begin(), p.fq.records.end());
+            fq.dust_scores.insert(fq.dust_scores.end(), p.fq.dust_scores.begin(), p.fq.dust_scores.end());
+            fq.low_complexity.insert(fq.low_complexity.end(), p.fq.low_complexity.begin(), p.fq.low_complexity.end());
+        }
+    } else if ( !file.empty() ) {
+        read_fq(file, &fq);
+    }
+
+    distribution_writer dust_scores(writer, "dust_scores", histogram::linear(1.0), opt::summary);
+    for ( auto const& d : fq.dust_scores ) {
+        dust_scores.add(d);
     }
-    //vector <double> contig_lengths;
-    while( getline(infile, line) ) {
-        char spec;
-        stringstream ss(line);
-        ss >> spec;
-
-        // get only lines that have summary information on the contig length
-        if ( spec == 'x' ) {
-            string ctgName;
-            int ctgLen;
-            ss >> spec >> ctgName >> ctgLen;
-            auto i = ctgs.find(ctgName);
-            i->second.len = ctgLen;
+    dust_scores.finish();
+
+    // fraction of each sampled read in low-complexity DUST windows
+    if ( opt::dust_window > 0 ) {
+        distribution_writer fractions(writer, "low_complexity_fractions", histogram::linear(0.01), opt::summary);
+        for ( auto const& f : fq.low_complexity ) {
+            fractions.add(f);
         }
+        fractions.finish();
+    }
+    if ( state != NULL ) {
+        return fq.records;
     }
+    return move(values.records);
 }
 
-void calculate_repetitivity(map<string, contig> ctg, double g, int n, JSONWriter* writer)
+void parse_gfa(map<string, contig>* ctgs)
 {
-    // to calculate the astatistic for each read
-    // we need k = the number of reads in the contig, total number of reads (n)
-    // the length of contig = l, and the gse (G)
-    long unsigned int r = 0;
-    long unsigned int u = 0;
-    double singleCopyTheshold = 30.0;
-    double arrivalRate = double(n)/g;
-
-    // compute final a stat values
-    for (auto const& c: ctg){
-        int k = c.second.num_reads;
-        int l = c.second.len;
-        double astat = arrivalRate*double(l) - double(k)*log(2);
-        //cout << c.first << ": " << k << "\t" << l << "\t" << astat << "\n";
-        if ( astat >= singleCopyTheshold ) {
-            u += l;
-        } else {
-            r += l;
+    // the contig lengths are from the segments of the gfa
+    gfa_reader reader(opt::gfa_file);
+    if ( !reader.is_open() ) {
+        fprintf(stderr, "ERROR: GFA failed to open. Check to see if it exists, is readable, and is non-empty.\n\n");
+        exit(EXIT_FAILURE);
+    }
+    gfa_segment s;
+    while ( reader.next(&s) ) {
+        // contigs without reads aligned to them are added with none
+        auto i = ctgs->find(s.name);
+        if ( i == ctgs->end() ) {
+            i = ctgs->insert(pair<string, contig>(s.name, contig())).first;
+            i->second.num_reads = 0;
         }
+        i->second.len = s.len;
     }
+    metrics.current().add(reader.metrics());
+}
+
+void calculate_repetitivity(const map<string, contig>& ctg, double g, int n, JSONWriter* writer)
+{
+    // contigs are repeats or unique by their A-statistic
+    repeat_bases b = classify_contigs(ctg, g, n);
+    uint64_t r = b.rep;
+    uint64_t u = b.unique;
 
     cout << "% rep: " << double(r)/double(g) << "\n";
     cout << "% unique: " << double(u)/double(g) << "\n";
@@ -775,99 +1369,134 @@ void calculate_repetitivity(map<string, contig> ctg, double g, int n, JSONWriter
 map<string, contig> calculate_ctgs() {
     // ctgs dict: key = ctg name, value = contig (length, number of reads aligned)
     map<string, contig> ctgs;
-    const char *bam_file = "./reads-to-contigs.bam";
-    htsFile *fp1 = NULL;
-    fp1 = hts_open(bam_file,"rb"); //open bam file
-    bam1_t *read1 = bam_init1();
+    htsFile *fp1 = hts_open(opt::bam_file.c_str(), "r");
+    if ( fp1 == NULL ) {
+        fprintf(stderr, "ERROR: BAM file %s failed to open. Check to see if it exists and is readable, or set it with --bam.\n\n", opt::bam_file.c_str());
+        exit(EXIT_FAILURE);
+    }
     bam_hdr_t *header1 = sam_hdr_read(fp1);
-    int tot_reads = 0;
-    long int sum_read_lens = 0;
-    while(sam_read1(fp1, header1, read1) >= 0) {
-        if( (read1->core.flag & BAM_FUNMAP) == 0 ) {
-            string ctgName = header1->target_name[read1->core.tid];
-            int ctgLen = header1->target_len[read1->core.tid];
-            // update contig dict
-            auto i = ctgs.find(ctgName);
-            if ( i == ctgs.end() ) {
-                contig c;
-                c.set(ctgLen, 1);
-                ctgs.insert(pair<string, contig>(ctgName, c));
-            } else {
-                i->second.num_reads += 1;
+    if ( header1 == NULL ) {
+        fprintf(stderr, "ERROR: failed to read the header of the BAM file %s.\n\n", opt::bam_file.c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    // mapped reads of each contig, indexed by tid
+    vector<uint64_t> num_reads(header1->n_targets, 0);
+    hts_idx_t *idx = sam_index_load(fp1, opt::bam_file.c_str());
+    if ( idx != NULL ) {
+        // the index has the counts, no record is read
+        for ( int tid = 0; tid < header1->n_targets; tid++ ) {
+            uint64_t mapped = 0, unmapped = 0;
+            if ( hts_idx_get_stat(idx, tid, &mapped, &unmapped) == 0 ) {
+                num_reads[tid] = mapped;
+            }
+        }
+        hts_idx_destroy(idx);
+    } else {
+        // records are decompressed on worker threads with --threads
+        if ( threads_of.bam > 1 ) {
+            hts_set_threads(fp1, threads_of.bam);
+        }
+        bam1_t *read1 = bam_init1();
+        int ret;
+        while( (ret = sam_read1(fp1, header1, read1)) >= 0 ) {
+            if( (read1->core.flag & BAM_FUNMAP) == 0 && read1->core.tid >= 0 ) {
+                num_reads[read1->core.tid]++;
             }
-            // track total reads
-            int qLen = read1->core.l_qseq;
-            tot_reads += 1;
-            sum_read_lens += qLen;
+        }
+        bam_destroy1(read1);
+        if ( ret < -1 ) {
+            fprintf(stderr, "ERROR: failed to read the BAM file %s. Check to see if it is truncated or corrupted.\n\n", opt::bam_file.c_str());
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // contigs with reads aligned to them
+    for ( int tid = 0; tid < header1->n_targets; tid++ ) {
+        if ( num_reads[tid] > 0 ) {
+            contig c;
+            c.set(header1->target_len[tid], (int)num_reads[tid]);
+            ctgs.insert(pair<string, contig>(header1->target_name[tid], c));
         }
     }
 
     bam_hdr_destroy(header1);
-    bam_destroy1(read1);
     hts_close(fp1);
     return ctgs;
 }
 
-void calculate_ngx(map<string, contig> ctgs, double genome_size_est, JSONWriter* writer ){
+void calculate_ngx(const map<string, contig>& ctgs, double genome_size_est, JSONWriter* writer ){
     /*
     ========================================================
     Calculating NGX
     --------------------------------------------------------
     Uses GFA information to evaluate the assembly quality
-    Input:      All the contig lengths in MB ****
+    Input:      All the contig lengths
     Output:     NGX values in a dictionary:
                 key   = X
                 value = contig length where summing contigs 
                 with length greater than or equal to this 
                 length is Xth percentile
                 of the genome size estimate....
+                LGX values, the number of contigs summed,
+                and auNG, for the estimate and for each
+                genome size of --genome-size
     ========================================================
     */
-    // gx dict: key = x percent of the genome size estimate, value = x
-    int x = 0;
-    map<double, int> gx;
-    while ( x <= 100 ) {
-        gx.insert( make_pair((double(x) * genome_size_est)/100, x) );
-        x += 1;
-    }
-
-    // save only contig lengths
-    vector<int> contig_lengths;
+    vector<uint64_t> contig_lengths;
+    contig_lengths.reserve(ctgs.size());
     for ( auto const& c: ctgs ) {
         contig_lengths.push_back(c.second.len);
-    } 
-
-    // sort in descending order the contig_lengths
-    sort(contig_lengths.rbegin(), contig_lengths.rend());
-   
-    // ngx dict: key = x, value = ngx
-    map<int, double> ngx;
-    double start = 0, end = 0;
-    for ( auto const& c : contig_lengths ) {
-       end += double(c);
-       // for all values that are less than the curr sum
-       for ( auto& p : gx ) {
-           if ( ( p.first >= start ) && ( p.first <= end ) ) {
-               ngx.insert( make_pair(p.second, c) );
-           }           
-       }
-       start += c;
-    }
-
-    // write to JSON object
+    }
+
+    vector<double> genome_sizes(1, genome_size_est);
+    genome_sizes.insert(genome_sizes.end(), opt::genome_sizes.begin(), opt::genome_sizes.end());
+    vector<ngx_stats> stats = ngx_sweep(&contig_lengths, opt::ngx_x, genome_sizes);
+
+    // the estimate is written at the top level, the other sizes after it
+    write_ngx(stats[0], writer);
+    if ( stats.size() > 1 ) {
+        writer->Key("ngx_references");
+        writer->StartArray();
+        for ( size_t g = 1; g < stats.size(); g++ ) {
+            writer->StartObject();
+            writer->Key("genome_size");
+            writer->Double(stats[g].genome_size);
+            write_ngx(stats[g], writer);
+            writer->EndObject();
+        }
+        writer->EndArray();
+    }
+}
+
+void write_ngx(const ngx_stats& s, JSONWriter* writer)
+{
+    // x is written as short as it reads, "50" or "12.5"
+    vector<string> keys;
+    for ( auto const& v : s.values ) {
+        char key[32];
+        snprintf(key, sizeof(key), "%g", v.x);
+        keys.push_back(key);
+    }
     writer->Key("ngx_values");
     writer->StartObject();
-    for ( auto& p : ngx ) {
-        string key = to_string(p.first);
-        // x value:
-        writer->Key(key.c_str());
-        // ngx value:
-        writer->Double(p.second);
-    }
-    writer->EndObject();   
+    for ( size_t i = 0; i < s.values.size(); i++ ) {
+        writer->Key(keys[i].c_str());
+        writer->Double(s.values[i].ngx);
+    }
+    writer->EndObject();
+    writer->Key("lgx_values");
+    writer->StartObject();
+    for ( size_t i = 0; i < s.values.size(); i++ ) {
+        writer->Key(keys[i].c_str());
+        writer->Uint64(s.values[i].lgx);
+    }
+    writer->EndObject();
+    writer->Key("aung");
+    writer->Double(s.aung);
 }
 
-void calculate_tot_bases( map<string, sequence> paf, JSONWriter* writer){
+void calculate_tot_bases( const read_table& paf, JSONWriter* writer){
     /*
     ========================================================
     Calculating total number of bases as a function of 
@@ -875,85 +1504,35 @@ void calculate_tot_bases( map<string, sequence> paf, JSONWriter* writer){
     --------------------------------------------------------
     Shows the total number of bases with varying minimum 
     read length cut offs.
-    Input:      Dictionary of reads with read length info in value
+    Input:      Table of reads with read length info
     Output:     Dictionary:
-                key   = read length cut off
-                value = total number of bases
+                key   = read length cut off, the smallest
+                        length of a bin of the read lengths
+                value = total number of kilobases
     ========================================================
     */
-
-    // bin the reads by read length in BASES, and sort in decreasing order
-    map<unsigned int, int, greater<unsigned int>> read_lengths;
-    for( auto it : paf) {
-        string id = it.first;
-        unsigned int r_len = it.second.read_len;
-
-        // add new read length if not in map yet
-        auto j = read_lengths.find(r_len);
-        if ( j == read_lengths.end() ) {
-            // not found
-            read_lengths.insert( pair<unsigned int,int>(r_len, 1) );
-        } else {
-            // length found
-            j->second += 1;
+    length_curve curve(histogram::log(100));
+    for( uint32_t id = 0; id < paf.n_ids(); id++ ) {
+        if ( paf.init[id] ) {
+            curve.add(paf.read_len[id]);
         }
     }
-
     writer->Key("total_num_bases_vs_min_read_length");
-    writer->StartObject();
-    double curr_longest;   // current longest readlength in BASES
-    unsigned int nr;       // number of reads with read length
-    double nb;             // total number of KILOBASES of reads with current longest read length
-    double tot_num_bases = 0;
-    for (const auto& p : read_lengths) {
-        curr_longest = double(p.first);
-        nr = p.second;
-        nb = (curr_longest/double(1000.0)) * nr;
-
-        // detect for potential overflow issues:
-        // SO: https://stackoverflow.com/questions/199333/how-to-detect-integer-overflow
-        // curr_longest * nr may have encountered an overflow issue
-        // leading to a negative number. We do not include negative nb.
-        if (!(nb > 0) || !(tot_num_bases > INT_MAX - nb)) {
-            // would not overflow 
-            tot_num_bases += nb;
-            string key = to_string(curr_longest);
-            writer->Key(key.c_str());
-            writer->Int(tot_num_bases);
-        }
-    }
-    writer->EndObject();
+    curve.write(writer);
 }
 
-// Dust scoring scheme as given by:
-// Morgulis A. "A fast and symmetric DUST implementation to Mask
-// Low-Complexity DNA Sequences". J Comp Bio.
-double calculateDustScore(const string& seq)
+void calculate_tot_bases_fq(const vector<pair<double,int>>& fq, JSONWriter* writer)
 {
-    map<string, size_t> scoreMap;
-
-    // Cannot calculate dust scores on very short reads
-    if(seq.size() < 3)
-        return 0.0f;
-
-    // Slide a 3-mer window over the sequence and insert the sequences into the map
-    for(size_t i = 0; i < seq.size() - 5; ++i)
-    {
-        string triMer = seq.substr(i, 3);
-        scoreMap[triMer]++;
+    // the same curve for every read of the reads file, with or without overlaps
+    length_curve curve(histogram::log(100));
+    for ( auto const& r : fq ) {
+        curve.add(r.second);
     }
-
-    // Calculate the score by summing the square of every element in the map
-    float sum = 0;
-    for (auto& iter : scoreMap) {
-        size_t tc = iter.second;
-        double score = (double)(tc * (tc - 1)) / 2.0f;
-        sum += score;
-    }
-    return sum / (seq.size() - 4);
+    writer->Key("total_num_bases_vs_min_read_length_reads");
+    curve.write(writer);
 }
 
-void calculate_GC_content( vector <pair<double, int>> fq, JSONWriter* writer )
+void calculate_GC_content( const vector <pair<double, int>>& fq, JSONWriter* writer )
 {
     /*
     ========================================================
@@ -966,32 +1545,32 @@ void calculate_GC_content( vector <pair<double, int>> fq, JSONWriter* writer )
     ========================================================
     */
 
-    writer->Key("read_counts_per_GC_content");
-    writer->StartArray();
-    map<double, int> freq; // store counts for each GC content 
-    int max = 0;
-    double mode = 0.0;
-    for (auto &r : fq) {
+    distribution_writer gc_content(writer, "read_counts_per_GC_content", histogram::linear(1.0), opt::summary);
+    for (auto const& r : fq) {
          if ( r.first != 0 ) {
-             writer->Double(r.first);
-             auto i = freq.find(round(r.first * 10.0)/10.0); // round to nearest 100th decimal place
-             if ( i == freq.end() ){ 
-                 freq.insert(make_pair(round(r.first*10.0)/10.0, 1));
-             } else {
-                 i->second+=1;
-                 if ( i->second > max ){
-                     max = i->second;
-                     mode = i->first;
-                 }
-             }
+             gc_content.add(r.first);
          }
     }
-    writer->EndArray();
+    gc_content.finish();
     writer->Key("peak_GC_content");
-    writer->Double(mode);
+    writer->Double(peak_gc_content(fq));
 }
 
-double calculate_est_cov_and_est_genome_size( map<string, sequence> paf, JSONWriter* writer )
+gse_stats estimate_genome_size(const read_table& paf, bool keep_low_cov, bool keep_high_cov)
+{
+    // coverage and overlap region length of each read
+    coverage_stats covs;
+    for ( uint32_t id = 0; id < paf.n_ids(); id++ )
+    {
+        if ( !paf.init[id] ) {
+            continue;
+        }
+        covs.add(paf.cov[id], paf.max_e[id] - paf.min_s[id]);
+    }
+    return covs.estimate(keep_low_cov, keep_high_cov);
+}
+
+double calculate_est_cov_and_est_genome_size( const read_table& paf, JSONWriter* writer )
 {
     /*
     ========================================================
@@ -999,159 +1578,123 @@ double calculate_est_cov_and_est_genome_size( map<string, sequence> paf, JSONWri
     --------------------------------------------------------
     For each read uses length and sum of lengths of all 
     overlaps.
-    Input:    PAF records dictionary
+    Input:    PAF records table
     Output:   Dictionary: (each entry is a read)
               key = est coverage
               value = read length 
     ========================================================
     */
-    // key = cov, value = num. reads with cov
-    vector<pair<double, int>> covs;
-
     // make an object that will hold pair of coverage and read length
-    writer->Key("per_read_est_cov_and_read_length");
-    writer->StartObject();
-    long long sum_len = 0;
-    long double sum_cov = 0;
-    int tot_reads = 0;
-    map<double,long long int, greater<double>> per_cov_total_num_bases;
-    for ( auto it : paf )
+    // with --summary, only the distribution of coverages is written
+    distribution cov_dist(histogram::linear(1.0));
+    if ( !opt::summary ) {
+        writer->Key("per_read_est_cov_and_read_length");
+        writer->StartObject();
+    }
+    for ( uint32_t id = 0; id < paf.n_ids(); id++ )
     {
-        string id = it.first;
-        sequence r = it.second;
-        int r_len = r.max_e - r.min_s;
-        long double r_cov = r.cov;
-        string key = to_string(r_cov);
-        writer->Key(key.c_str());
-        writer->Int(r_len);
-        covs.push_back(make_pair(r_cov,r_len));        
-        sum_cov += r_cov;
-        tot_reads += 1;
-        sum_len += r_len;
-
-        // save total bases for each coverage level
-        auto j = per_cov_total_num_bases.find(round(r_cov));
-        if ( j == per_cov_total_num_bases.end() ){
-            per_cov_total_num_bases.insert(pair<double, long long int>(round(r_cov), r_len));
+        if ( !paf.init[id] ) {
+            continue;
+        }
+        int r_len = paf.max_e[id] - paf.min_s[id];
+        long double r_cov = paf.cov[id];
+        if ( opt::summary ) {
+            cov_dist.add(r_cov);
         } else {
-            j->second += r_len;
+            string key = to_string(r_cov);
+            writer->Key(key.c_str());
+            writer->Int(r_len);
         }
     }
-    writer->EndObject();
+    if ( opt::summary ) {
+        writer->Key("per_read_est_cov_and_read_length");
+        cov_dist.write(writer);
+    } else {
+        writer->EndObject();
+    }
 
-    // calculate IQR to use as limits in plotting script
-    // sort the estimated coverages
-    sort(covs.begin(), covs.end());
-
-    // get the index of the 25th and 75th percentile item
-    int i25 = ceil(covs.size() * 0.25);
-    int i75 = ceil(covs.size() * 0.75); 
-    double IQR = covs[i75].first - covs[i25].first;
-    double bd = IQR*1.5;
-    double upperbound = round(double(covs[i75].first) + bd);
-    double lowerbound = (round(double(covs[i25].first) - bd)>3.0) ? round(double(covs[i25].first) - bd) : 3.0;
-    if ( opt::keep_low_cov ) {
-        lowerbound = 3.0;
-    }
-    if ( opt::keep_high_cov ) {
-        upperbound = 1000;
-    }
-
-    // filter by coverage
-    long long sum_len_f = 0;
-    long double sum_cov_f = 0;
-    int tot_reads_f = 0;
-    vector<double> covs_f;
-    // the following are used to get the mode of distribution
-    // we bin the reads by coverage incrementing by 0.25x
-    // we start binning from the lowest value of cov calculated
-    double l = lowerbound;
-    double u = l + 0.25;
-    double curr_largest = -1000.0;
-    double mode_cov = 0;
-    int count = 0;
-    unsigned int i = 0;
-    // we want to only consider reads above the lowerbound
-    while ( covs[i].first < l ) {
-        i += 1;
-    }
-    while ( i < covs.size() ){ 
-        // iterate through reads
-        // look at reads that fall within current bin
-        while ( covs[i].first >= l && covs[i].first < u ){ 
-            // filter outliers: [Q25-IQR*1.5, Q75+IQR*1.5]
-            if ( (covs[i].first >= lowerbound) && (covs[i].first <= upperbound) ){
-                // count how many reads have coverage in current bin
-                count += 1;
-                tot_reads_f += 1;
-                sum_len_f += covs[i].second;
-                sum_cov_f += covs[i].first;
-                covs_f.push_back(covs[i].first);
-            }
-            i += 1;
-        }
-        // if this bin has the most amount of reads, the coverage is the mode
-        if (( count > curr_largest ) && ( u > lowerbound )) {
-            curr_largest = count;
-            mode_cov = u;
-        }
-        // next bin 
-        u += 0.25;
-        l += 0.25;
-        count = 0;
-    }
-
-    // get the mean read length
-    double mean_read_len = sum_len_f/double(tot_reads_f);
-
-    // get the median coverage
-    int i50 = ceil(covs_f.size() * 0.50);
-    double median_cov = double(covs_f[i50]);
-
-    // calculate estimated genome size
-    double est_genome_size = ( tot_reads_f * mean_read_len ) / double(mode_cov);
-    double est_genome_size1 = ( tot_reads_f * mean_read_len ) / double(median_cov);
-    out("mode cov: " + to_string(mode_cov));
-    out("median cov: " + to_string(median_cov));
-    out("mean read length: " + to_string(mean_read_len));
-    out("est genome size with mode cov: " + to_string(est_genome_size));
-    out("est genome size with median cov: " + to_string(est_genome_size1));
-    out("tot reads: " + to_string(tot_reads_f) );
+    gse_stats g = estimate_genome_size(paf, opt::keep_low_cov, opt::keep_high_cov);
+    out("mode cov: " + to_string(g.mode_cov));
+    out("median cov: " + to_string(g.median_cov));
+    out("mean read length: " + to_string(g.mean_read_len));
+    out("est genome size with mode cov: " + to_string(g.est_genome_size));
+    out("est genome size with median cov: " + to_string(g.est_genome_size1));
+    out("tot reads: " + to_string(g.tot_reads_f) );
     if ( opt::print_gse_stat ) {
         cout <<"sample_name\tmode_cov\tmedian_cov\tmean_read_len\ttot_reads_before_filter\ttot_reads_after_filter\ttot_bases_before_filter\ttot_bases_after_filter\test_genome_size_with_mode_cov\test_genome_size_with_median_cov\n";
-        cout <<  opt::sample_name << "\t" << mode_cov << "\t" <<  median_cov << "\t" << mean_read_len << "\t" << tot_reads  << "\t" << tot_reads_f << "\t" << sum_len << "\t" << sum_len_f << "\t"<< est_genome_size << "\t" <<  est_genome_size1 << "\n";
+        cout <<  opt::sample_name << "\t" << g.mode_cov << "\t" <<  g.median_cov << "\t" << g.mean_read_len << "\t" << g.tot_reads  << "\t" << g.tot_reads_f << "\t" << g.sum_len << "\t" << g.sum_len_f << "\t"<< g.est_genome_size << "\t" <<  g.est_genome_size1 << "\n";
     }
     // now store in JSON object
     writer->Key("est_cov_post_filter_info");
     writer->StartArray();
-    writer->Double(lowerbound);
-    writer->Double(upperbound);
-    writer->Int(tot_reads);
-    writer->Double(IQR);
+    writer->Double(g.lowerbound);
+    writer->Double(g.upperbound);
+    writer->Int(g.tot_reads);
+    writer->Double(g.IQR);
     writer->EndArray();
 
     writer->Key("est_genome_size");
-    writer->Double(est_genome_size);    
+    writer->Double(g.est_genome_size);    
 
     writer->Key("mean_read_len");
-    writer->Double(mean_read_len);
+    writer->Double(g.mean_read_len);
 
     writer->Key("median_cov");
-    writer->Double(median_cov);
+    writer->Double(g.median_cov);
 
     writer->Key("mode_cov");
-    writer->Double(mode_cov);
+    writer->Double(g.mode_cov);
 
     writer->Key("peak_cov");
-    writer->Double(round(mode_cov*100.0)/100.0);
+    writer->Double(round(g.mode_cov*100.0)/100.0);
 
     writer->Key("tot_reads");
-    writer->Int(tot_reads_f);
+    writer->Int(g.tot_reads_f);
 
-    return est_genome_size;
+    return g.est_genome_size;
 }
 
-void write_read_length(vector<pair<double,int>> fq, JSONWriter* writer)
+void write_sweep(const vector<sweep_result>& sweep, JSONWriter* writer)
+{
+    // one object per configuration of the sweep, in the order of the grid
+    writer->Key("sweep");
+    writer->StartArray();
+    for ( auto const& r : sweep ) {
+        writer->StartObject();
+        writer->Key("min_iden");
+        writer->Double(r.config.filter.min_iden);
+        writer->Key("min_olen");
+        writer->Uint(r.config.filter.min_olen);
+        writer->Key("min_rlen");
+        writer->Uint(r.config.filter.min_rlen);
+        writer->Key("min_match");
+        writer->Uint(r.config.filter.min_match);
+        writer->Key("keep_dups");
+        writer->Bool(r.config.keep_dups);
+        writer->Key("overlaps_used");
+        writer->Uint64(r.n_overlaps);
+        writer->Key("tot_reads_before_filter");
+        writer->Int(r.gse.tot_reads);
+        writer->Key("tot_reads");
+        writer->Int(r.gse.tot_reads_f);
+        writer->Key("mean_read_len");
+        writer->Double(r.gse.mean_read_len);
+        writer->Key("mode_cov");
+        writer->Double(r.gse.mode_cov);
+        writer->Key("median_cov");
+        writer->Double(r.gse.median_cov);
+        writer->Key("est_genome_size");
+        writer->Double(r.gse.est_genome_size);
+        writer->Key("est_genome_size_with_median_cov");
+        writer->Double(r.gse.est_genome_size1);
+        writer->Key("cov");
+        r.cov.write(writer);
+        writer->EndObject();
+    }
+    writer->EndArray();
+}
+
+void write_read_length(const vector<pair<double,int>>& fq, JSONWriter* writer)
 {
     /*
     ========================================================
@@ -1163,12 +1706,11 @@ void write_read_length(vector<pair<double,int>> fq, JSONWriter* writer)
     ========================================================
     */
 
-    writer->Key("read_lengths");
-    writer->StartArray();
+    distribution_writer read_lengths(writer, "read_lengths", histogram::log(100), opt::summary);
 
     // loop through the map of reads and get read lengths
-    for(auto &r : fq) {
-        writer->Int(r.second);
+    for(auto const& r : fq) {
+        read_lengths.add(r.second);
     }
-    writer->EndArray();
+    read_lengths.finish();
 }
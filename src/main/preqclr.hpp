@@ -8,12 +8,20 @@
 
 #include <map>
 #include <string>
+#include <vector>
 #include <stdio.h>
 #include <stdlib.h>
-#include "sequence.hpp"
+#include "read_table.hpp"
 #include "contig.hpp"
+#include "json_writer.hpp"
+#include "summary.hpp"
+#include "fq_reader.hpp"
 
-#include "readpaf/paf.h"
+#include "paf_reader.hpp"
+#include "overlap_engine.hpp"
+#include "cov_stats.hpp"
+#include "qc_state.hpp"
+#include "ngx.hpp"
 
 #include "rapidjson/document.h"
 #include "rapidjson/writer.h"
@@ -25,21 +33,56 @@
 using namespace std;
 using namespace rapidjson;
 
-typedef PrettyWriter<StringBuffer> JSONWriter;
+typedef json_writer JSONWriter;
 
-double calculate_est_cov_and_est_genome_size(map<string, sequence> paf, JSONWriter* writer);
-void write_read_length(vector <pair <double, int>> fq, JSONWriter* writer);
-void calculate_GC_content(vector <pair <double, int>> fq, JSONWriter* writer);
-void calculate_tot_bases(map<string, sequence> paf, JSONWriter* writer);
-void calculate_ngx(map<string, contig> contigs, double genome_size_est, JSONWriter* writer);
-void calculate_total_num_bases_vs_min_cov(map<double, long long int, greater<double>> per_cov_total_num_bases, JSONWriter* writer);
-void calculate_repetitivity(map<string, contig> ctg, double g, int n, JSONWriter* writer);
-double calculateDustScore(const string& seq);
+// genome size estimate and coverage of one --sweep configuration
+struct sweep_result
+{
+    overlap_config config;
+    size_t n_overlaps;      // overlaps used for coverage
+    gse_stats gse;
+    distribution cov;
+};
+
+// results of the parsing passes, shared read-only by the calculate_* stages
+struct qc_results
+{
+    vector<pair<double, int>> fq_records;
+    read_table paf_records;
+    map<string, contig> contigs;
+    vector<sweep_result> sweep;
+};
+
+gse_stats estimate_genome_size(const read_table& paf, bool keep_low_cov, bool keep_high_cov);
+double calculate_est_cov_and_est_genome_size(const read_table& paf, JSONWriter* writer);
+void write_sweep(const vector<sweep_result>& sweep, JSONWriter* writer);
+void write_read_length(const vector <pair <double, int>>& fq, JSONWriter* writer);
+void calculate_GC_content(const vector <pair <double, int>>& fq, JSONWriter* writer);
+void calculate_tot_bases(const read_table& paf, JSONWriter* writer);
+void calculate_tot_bases_fq(const vector<pair<double, int>>& fq, JSONWriter* writer);
+void calculate_ngx(const map<string, contig>& contigs, double genome_size_est, JSONWriter* writer);
+void write_ngx(const ngx_stats& s, JSONWriter* writer);
+void calculate_repetitivity(const map<string, contig>& ctg, double g, int n, JSONWriter* writer);
 map<string, contig> calculate_ctgs();
 
-int getopt( int argc, char* const* argv[], const char *optstring);
-enum { OPT_VERSION, OPT_KEEP_LOW_COV, OPT_KEEP_HIGH_COV, OPT_KEEP_DUPS, OPT_REMOVE_INT_MATCHES, OPT_MAX_OVERHANG, OPT_MAX_OVERHANG_RATIO, OPT_REMOVE_CONTAINED, OPT_PRINT_READ_COV, OPT_KEEP_SELF_OVERLAPS, OPT_PRINT_GSE_STAT, OPT_PRINT_NEW_PAF };
+enum { OPT_VERSION, OPT_KEEP_LOW_COV, OPT_KEEP_HIGH_COV, OPT_KEEP_DUPS, OPT_REMOVE_INT_MATCHES, OPT_MAX_OVERHANG, OPT_MAX_OVERHANG_RATIO, OPT_REMOVE_CONTAINED, OPT_PRINT_READ_COV, OPT_KEEP_SELF_OVERLAPS, OPT_PRINT_GSE_STAT, OPT_PRINT_NEW_PAF, OPT_COMPACT, OPT_SUMMARY, OPT_DUST_WINDOW, OPT_SAMPLE_FRACTION, OPT_SAMPLE_SEED, OPT_CACHE, OPT_WRITE_CACHE, OPT_SWEEP, OPT_RESUME_STATE, OPT_SAVE_STATE, OPT_PARTIAL, OPT_MERGE, OPT_METRICS, OPT_LOG_LEVEL, OPT_BAM, OPT_NGX, OPT_GENOME_SIZE };
 void parse_args(int argc, char *argv[]);
-map<string, sequence> parse_paf(JSONWriter* writer);
-void parse_gfa(map<string, contig> ctgs);
-vector<pair<double,int>> parse_fq(string readsFile, JSONWriter* writer);
+size_t estimate_num_overlaps(const string& file);
+overlap_config make_overlap_config();
+bool parse_values(const string& list, vector<double>* values);
+vector<overlap_config> parse_sweep(const string& spec, const overlap_config& base);
+qc_settings current_settings();
+unique_ptr<qc_state> start_state();
+qc_partial read_partial(const string& fn, bool with_overlaps);
+void write_partial();
+void add_filter_metrics(paf_reader* reader, const uint64_t* dropped);
+void add_engine_metrics(const overlap_engine& engine);
+// splits --threads between the passes over the input files that run at
+// the same time, returns the number of passes at the same time
+unsigned int share_threads(bool sequential, bool with_bam);
+void write_prometheus();
+read_table parse_paf(JSONWriter* writer, vector<sweep_result>* sweep, qc_state* state);
+void parse_gfa(map<string, contig>* ctgs);
+void calculate_read_stats(fq_batch* b);
+void read_fq(const string& file, fq_values* fq);
+vector<pair<double,int>> parse_fq(string readsFile, JSONWriter* writer, qc_state* state);
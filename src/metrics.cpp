@@ -0,0 +1,252 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr metrics -- resource use and throughput of each stage of a
+// run, written to the preqclr file and as Prometheus text
+//
+#include "metrics.hpp"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+using namespace std;
+
+static double wall_seconds()
+{
+    return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double cpu_seconds()
+{
+    struct timespec ts;
+    if ( clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0 ) {
+        return 0;
+    }
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// stage running on the thread
+static thread_local stage_metrics* running = NULL;
+
+uint64_t current_rss_kb()
+{
+    // the second field of statm is the resident size in pages
+    FILE* fp = fopen("/proc/self/statm", "r");
+    if ( fp == NULL ) {
+        return 0;
+    }
+    unsigned long size = 0, resident = 0;
+    int n = fscanf(fp, "%lu %lu", &size, &resident);
+    fclose(fp);
+    if ( n != 2 ) {
+        return 0;
+    }
+    return uint64_t(resident) * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+uint64_t peak_rss_kb()
+{
+    // ru_maxrss is in kB on Linux
+    struct rusage ru;
+    if ( getrusage(RUSAGE_SELF, &ru) != 0 ) {
+        return 0;
+    }
+    return ru.ru_maxrss;
+}
+
+void stage_metrics::add(const input_metrics& in)
+{
+    bytes_read += in.bytes_read;
+    bytes_uncompressed += in.bytes_uncompressed;
+    records += in.records;
+    cpu_time += in.cpu_time;
+    // a stage reading several files reuses the thread slots
+    if ( thread_busy.size() < in.busy.size() ) {
+        thread_busy.resize(in.busy.size(), 0.0);
+    }
+    for ( size_t i = 0; i < in.busy.size(); i++ ) {
+        thread_busy[i] += in.busy[i];
+    }
+}
+
+void stage_metrics::add_filtered(const string& reason, uint64_t n)
+{
+    for ( auto& f : filtered ) {
+        if ( f.first == reason ) {
+            f.second += n;
+            return;
+        }
+    }
+    filtered.push_back(make_pair(reason, n));
+}
+
+void run_metrics::start(const string& name)
+{
+    finish();
+    {
+        // stages already in the deque do not move
+        lock_guard<mutex> lock(m);
+        stages.push_back(stage_metrics());
+        running = &stages.back();
+    }
+    running->name = name;
+    running->start_wall = wall_seconds();
+    running->start_cpu = cpu_seconds();
+}
+
+const stage_metrics* run_metrics::finish()
+{
+    stage_metrics* s = running;
+    if ( s == NULL ) {
+        return NULL;
+    }
+    lock_guard<mutex> lock(m);
+    s->wall_time = wall_seconds() - s->start_wall;
+    // the reader threads were added as they finished
+    s->cpu_time += cpu_seconds() - s->start_cpu;
+    s->rss_kb = current_rss_kb();
+    s->peak_rss_kb = peak_rss_kb();
+    running = NULL;
+    return s;
+}
+
+stage_metrics& run_metrics::current()
+{
+    return *running;
+}
+
+// share of the wall time of the stage the reader threads were busy
+static double utilisation(const stage_metrics& s)
+{
+    double busy = 0;
+    for ( auto const& b : s.thread_busy ) {
+        busy += b;
+    }
+    if ( s.thread_busy.empty() || s.wall_time <= 0 ) {
+        return 0;
+    }
+    return busy / (s.wall_time * s.thread_busy.size());
+}
+
+static double records_per_second(const stage_metrics& s)
+{
+    return s.wall_time > 0 ? s.records / s.wall_time : 0;
+}
+
+void run_metrics::write(json_writer* writer) const
+{
+    lock_guard<mutex> lock(m);
+    uint64_t peak = 0;
+    writer->StartObject();
+    writer->Key("stages");
+    writer->StartArray();
+    for ( auto const& s : stages ) {
+        writer->StartObject();
+        writer->Key("name");
+        writer->String(s.name.c_str());
+        writer->Key("wall_time");
+        writer->Double(s.wall_time);
+        writer->Key("cpu_time");
+        writer->Double(s.cpu_time);
+        writer->Key("bytes_read");
+        writer->Uint64(s.bytes_read);
+        writer->Key("bytes_uncompressed");
+        writer->Uint64(s.bytes_uncompressed);
+        writer->Key("records");
+        writer->Uint64(s.records);
+        writer->Key("records_per_second");
+        writer->Double(records_per_second(s));
+        writer->Key("filtered");
+        writer->StartObject();
+        for ( auto const& f : s.filtered ) {
+            writer->Key(f.first.c_str());
+            writer->Uint64(f.second);
+        }
+        writer->EndObject();
+        writer->Key("rss_kb");
+        writer->Uint64(s.rss_kb);
+        writer->Key("peak_rss_kb");
+        writer->Uint64(s.peak_rss_kb);
+        writer->Key("thread_busy");
+        writer->StartArray();
+        for ( auto const& b : s.thread_busy ) {
+            writer->Double(b);
+        }
+        writer->EndArray();
+        writer->Key("thread_utilisation");
+        writer->Double(utilisation(s));
+        writer->EndObject();
+        peak = max(peak, s.peak_rss_kb);
+    }
+    writer->EndArray();
+    writer->Key("peak_rss_kb");
+    writer->Uint64(peak);
+    writer->EndObject();
+}
+
+// label values escape backslashes, quotes and newlines
+static string label(const string& v)
+{
+    string e;
+    for ( char c : v ) {
+        if ( c == '\\' || c == '"' ) {
+            e += '\\';
+            e += c;
+        } else if ( c == '\n' ) {
+            e += "\\n";
+        } else {
+            e += c;
+        }
+    }
+    return e;
+}
+
+bool run_metrics::write_prometheus(const string& fn, const string& sample) const
+{
+    lock_guard<mutex> lock(m);
+    FILE* fp = fopen(fn.c_str(), "w");
+    if ( fp == NULL ) {
+        return false;
+    }
+    string sl = "sample=\"" + label(sample) + "\"";
+
+    // one gauge of every stage
+    auto gauge = [&](const char* name, const char* help, function<double(const stage_metrics&)> value) {
+        fprintf(fp, "# HELP preqclr_%s %s\n# TYPE preqclr_%s gauge\n", name, help, name);
+        for ( auto const& s : stages ) {
+            fprintf(fp, "preqclr_%s{%s,stage=\"%s\"} %.17g\n", name, sl.c_str(), label(s.name).c_str(), value(s));
+        }
+    };
+    gauge("stage_wall_seconds", "Wall time of the stage.", [](const stage_metrics& s) { return s.wall_time; });
+    gauge("stage_cpu_seconds", "CPU time of the thread running the stage and of its reader threads.", [](const stage_metrics& s) { return s.cpu_time; });
+    gauge("stage_read_bytes", "Bytes read from the input files, compressed or not.", [](const stage_metrics& s) { return double(s.bytes_read); });
+    gauge("stage_uncompressed_bytes", "Bytes of input after decompression.", [](const stage_metrics& s) { return double(s.bytes_uncompressed); });
+    gauge("stage_records", "Records read by the stage.", [](const stage_metrics& s) { return double(s.records); });
+    gauge("stage_records_per_second", "Records read per second of wall time.", records_per_second);
+    gauge("stage_rss_bytes", "Resident set size at the end of the stage.", [](const stage_metrics& s) { return s.rss_kb * 1024.0; });
+    gauge("stage_peak_rss_bytes", "Peak resident set size at the end of the stage.", [](const stage_metrics& s) { return s.peak_rss_kb * 1024.0; });
+    gauge("stage_thread_utilisation", "Share of the wall time the reader threads were busy.", utilisation);
+
+    fprintf(fp, "# HELP preqclr_stage_filtered_records Records dropped by the stage, by reason.\n");
+    fprintf(fp, "# TYPE preqclr_stage_filtered_records gauge\n");
+    for ( auto const& s : stages ) {
+        for ( auto const& f : s.filtered ) {
+            fprintf(fp, "preqclr_stage_filtered_records{%s,stage=\"%s\",reason=\"%s\"} %llu\n",
+                    sl.c_str(), label(s.name).c_str(), label(f.first).c_str(), (unsigned long long)f.second);
+        }
+    }
+    fprintf(fp, "# HELP preqclr_stage_thread_busy_seconds Time each reader thread spent reading or processing.\n");
+    fprintf(fp, "# TYPE preqclr_stage_thread_busy_seconds gauge\n");
+    for ( auto const& s : stages ) {
+        for ( size_t i = 0; i < s.thread_busy.size(); i++ ) {
+            fprintf(fp, "preqclr_stage_thread_busy_seconds{%s,stage=\"%s\",thread=\"%zu\"} %.17g\n",
+                    sl.c_str(), label(s.name).c_str(), i, s.thread_busy[i]);
+        }
+    }
+    return fclose(fp) == 0;
+}
@@ -0,0 +1,72 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr metrics -- resource use and throughput of each stage of a
+// run, written to the preqclr file and as Prometheus text
+//
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <deque>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "json_writer.hpp"
+
+using namespace std;
+
+// what a reader took in, collected once its input is read
+struct input_metrics
+{
+    uint64_t bytes_read;            // from the file, compressed or not
+    uint64_t bytes_uncompressed;
+    uint64_t records;
+    vector<double> busy;            // seconds each reader thread was busy
+    double cpu_time;                // CPU seconds of the reader threads
+};
+
+struct stage_metrics
+{
+    string name;
+    double wall_time, cpu_time;     // seconds, cpu_time of the thread running the stage and of its reader threads
+    uint64_t bytes_read, bytes_uncompressed;
+    uint64_t records;
+    vector<pair<string, uint64_t>> filtered;   // records dropped, by reason
+    uint64_t rss_kb, peak_rss_kb;   // at the end of the stage
+    vector<double> thread_busy;
+    double start_wall, start_cpu;
+
+    void add(const input_metrics& in);
+    void add_filtered(const string& reason, uint64_t n);
+};
+
+// stages may run at the same time on different threads, each thread
+// runs one stage at a time; there is one run_metrics in a program
+class run_metrics
+{
+  public:
+    // a stage lasts until finish is called on the same thread
+    void start(const string& name);
+    // the stage finished, NULL if none was running
+    const stage_metrics* finish();
+    // the stage running on this thread, values are added to it by the stage itself
+    stage_metrics& current();
+
+    void write(json_writer* writer) const;
+    // one gauge per value, labelled with the sample and the stage
+    bool write_prometheus(const string& fn, const string& sample) const;
+
+  private:
+    mutable mutex m;
+    deque<stage_metrics> stages;    // in the order they started
+};
+
+// resident set size of the process, now and at its peak, in kB
+uint64_t current_rss_kb();
+uint64_t peak_rss_kb();
+
+#endif
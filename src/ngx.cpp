@@ -0,0 +1,70 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr ngx -- NGx, LGx and auNG of an assembly against one or more
+// genome sizes, in one sweep down its contig lengths
+//
+#include "ngx.hpp"
+#include <algorithm>
+#include <functional>
+
+using namespace std;
+
+// contigs sorted by the first selection; each one after doubles the sorted prefix
+static const size_t MIN_SORTED = 1024;
+
+vector<ngx_stats> ngx_sweep(vector<uint64_t>* lengths, const vector<double>& xs, const vector<double>& genome_sizes)
+{
+    vector<uint64_t>& l = *lengths;
+    double sum_sq = 0;
+    for ( auto const& c : l ) {
+        sum_sq += double(c) * double(c);
+    }
+
+    // every threshold of every genome size, smallest first
+    struct threshold
+    {
+        double bases;
+        size_t g, i;
+    };
+    vector<threshold> thresholds;
+    vector<ngx_stats> stats(genome_sizes.size());
+    for ( size_t g = 0; g < genome_sizes.size(); g++ ) {
+        stats[g].genome_size = genome_sizes[g];
+        stats[g].aung = genome_sizes[g] > 0 ? sum_sq / genome_sizes[g] : 0;
+        stats[g].values.resize(xs.size());
+        for ( size_t i = 0; i < xs.size(); i++ ) {
+            stats[g].values[i] = { xs[i], 0, 0 };
+            thresholds.push_back({ xs[i] * genome_sizes[g] / 100, g, i });
+        }
+    }
+    sort(thresholds.begin(), thresholds.end(),
+         [](const threshold& a, const threshold& b) { return a.bases < b.bases; });
+
+    // the sweep stops at the largest threshold, so the short contigs of a
+    // fragmented assembly are only ever selected past, not sorted
+    size_t n = l.size(), sorted = 0, t = 0;
+    double sum = 0;
+    for ( size_t k = 0; k < n && t < thresholds.size(); k++ ) {
+        if ( k == sorted ) {
+            size_t next = min(n, max(MIN_SORTED, 2 * sorted));
+            nth_element(l.begin() + sorted, l.begin() + next - 1, l.end(), greater<uint64_t>());
+            sort(l.begin() + sorted, l.begin() + next, greater<uint64_t>());
+            sorted = next;
+        }
+        sum += l[k];
+        for ( ; t < thresholds.size() && thresholds[t].bases <= sum; t++ ) {
+            ngx_value& v = stats[thresholds[t].g].values[thresholds[t].i];
+            v.ngx = l[k];
+            v.lgx = k + 1;
+        }
+    }
+
+    for ( auto& s : stats ) {
+        s.values.erase(remove_if(s.values.begin(), s.values.end(),
+                                 [](const ngx_value& v) { return v.lgx == 0; }),
+                       s.values.end());
+    }
+    return stats;
+}
@@ -0,0 +1,36 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr ngx -- NGx, LGx and auNG of an assembly against one or more
+// genome sizes, in one sweep down its contig lengths
+//
+#ifndef NGX_HPP
+#define NGX_HPP
+
+#include <stdint.h>
+#include <vector>
+
+using namespace std;
+
+// the contigs, longest first, reach x% of the genome size at the lgx-th
+// contig, whose length is ngx
+struct ngx_value
+{
+    double x;
+    uint64_t ngx;
+    uint64_t lgx;
+};
+
+struct ngx_stats
+{
+    double genome_size;
+    vector<ngx_value> values;   // in the order of the x, without those never reached
+    double aung;                // sum of the squared lengths over the genome size
+};
+
+// one ngx_stats per genome size; lengths is reordered, only as many of
+// the longest contigs as the largest threshold needs are sorted
+vector<ngx_stats> ngx_sweep(vector<uint64_t>* lengths, const vector<double>& xs, const vector<double>& genome_sizes);
+
+#endif
@@ -0,0 +1,228 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr overlap_cache -- binary, columnar copy of the overlaps of
+// a PAF file, written once and mapped by later runs
+//
+#include "overlap_cache.hpp"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+// file layout, in native byte order:
+//   header
+//   10 uint32_t columns of n values: qid tid ql qs qe tl ts te ml bl
+//   uint8_t column of n strands, padded to 8 bytes
+//   read names in id order, each NUL terminated
+static const char CACHE_MAGIC[8] = { 'P', 'Q', 'L', 'R', 'O', 'V', 'L', 0 };
+static const uint32_t CACHE_VERSION = 1;
+static const int N_UINT_COLS = 10;
+// values buffered per column before they are spilled
+static const size_t SPILL_SIZE = 1 << 16;
+
+struct cache_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t n_reads;
+    uint64_t n_overlaps;
+    uint64_t names_size;
+};
+
+static size_t pad8(size_t l)
+{
+    return (l + 7) & ~size_t(7);
+}
+
+cache_writer::cache_writer(const string& f)
+    : fn(f), tmp(N_UINT_COLS + 1, (FILE*)NULL), cols(N_UINT_COLS), names(sd_init(), sd_destroy), n(0)
+{
+    fp = fopen(fn.c_str(), "wb");
+    if ( fp == NULL ) {
+        return;
+    }
+    for ( size_t i = 0; i < tmp.size(); i++ ) {
+        // removed straight away, the open file stays usable
+        string t = fn + "." + to_string(i) + ".tmp";
+        tmp[i] = fopen(t.c_str(), "w+b");
+        if ( tmp[i] == NULL ) {
+            fprintf(stderr, "ERROR: failed to create %s.\n\n", t.c_str());
+            exit(EXIT_FAILURE);
+        }
+        remove(t.c_str());
+    }
+}
+
+cache_writer::~cache_writer()
+{
+    for ( auto t : tmp ) {
+        if ( t != NULL ) {
+            fclose(t);
+        }
+    }
+    if ( fp != NULL ) {
+        fclose(fp);
+    }
+}
+
+bool cache_writer::is_open() const
+{
+    return fp != NULL;
+}
+
+void cache_writer::add(const paf_record& r)
+{
+    key.assign(r.qn.s, r.qn.l);
+    uint32_t qid = sd_put(names.get(), key.c_str(), r.ql);
+    key.assign(r.tn.s, r.tn.l);
+    uint32_t tid = sd_put(names.get(), key.c_str(), r.tl);
+    uint32_t v[N_UINT_COLS] = { qid, tid, r.ql, r.qs, r.qe, r.tl, r.ts, r.te, r.ml, r.bl };
+    for ( int i = 0; i < N_UINT_COLS; i++ ) {
+        cols[i].push_back(v[i]);
+    }
+    rev.push_back(r.rev);
+    n++;
+    if ( rev.size() == SPILL_SIZE ) {
+        spill();
+    }
+}
+
+void cache_writer::spill()
+{
+    bool ok = true;
+    for ( int i = 0; i < N_UINT_COLS; i++ ) {
+        ok &= fwrite(cols[i].data(), sizeof(uint32_t), cols[i].size(), tmp[i]) == cols[i].size();
+        cols[i].clear();
+    }
+    ok &= fwrite(rev.data(), 1, rev.size(), tmp[N_UINT_COLS]) == rev.size();
+    rev.clear();
+    if ( !ok ) {
+        fprintf(stderr, "ERROR: failed to write the overlap cache next to %s.\n\n", fn.c_str());
+        exit(EXIT_FAILURE);
+    }
+}
+
+void cache_writer::finish()
+{
+    spill();
+    const sdict_t* d = names.get();
+    cache_header h;
+    memcpy(h.magic, CACHE_MAGIC, sizeof(h.magic));
+    h.version = CACHE_VERSION;
+    h.n_reads = d->n_seq;
+    h.n_overlaps = n;
+    h.names_size = 0;
+    for ( uint32_t i = 0; i < d->n_seq; i++ ) {
+        h.names_size += strlen(d->seq[i].name) + 1;
+    }
+
+    bool ok = fwrite(&h, sizeof(h), 1, fp) == 1;
+    // copy the columns over, in order
+    vector<char> buf(1 << 20);
+    for ( auto t : tmp ) {
+        rewind(t);
+        size_t l;
+        while ( (l = fread(buf.data(), 1, buf.size(), t)) > 0 ) {
+            ok &= fwrite(buf.data(), 1, l, fp) == l;
+        }
+        ok &= !ferror(t);
+    }
+    static const char zeros[8] = { 0 };
+    ok &= fwrite(zeros, 1, pad8(n) - n, fp) == pad8(n) - n;
+    for ( uint32_t i = 0; i < d->n_seq; i++ ) {
+        ok &= fputs(d->seq[i].name, fp) >= 0 && fputc(0, fp) == 0;
+    }
+    ok &= fflush(fp) == 0;
+    if ( !ok ) {
+        fprintf(stderr, "ERROR: failed to write the overlap cache %s.\n\n", fn.c_str());
+        exit(EXIT_FAILURE);
+    }
+}
+
+overlap_cache::overlap_cache(const string& fn) : map(NULL), size(0)
+{
+    memset(&cols, 0, sizeof(cols));
+    int fd = open(fn.c_str(), O_RDONLY);
+    if ( fd < 0 ) {
+        return;
+    }
+    struct stat st;
+    if ( fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(cache_header) ) {
+        close(fd);
+        return;
+    }
+    void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if ( p == MAP_FAILED ) {
+        return;
+    }
+    size = st.st_size;
+    map = p;
+
+    // check the header against the size of the file
+    const cache_header* h = (const cache_header*)map;
+    size_t n = h->n_overlaps;
+    size_t names_at = sizeof(cache_header) + N_UINT_COLS * sizeof(uint32_t) * n + pad8(n);
+    if ( memcmp(h->magic, CACHE_MAGIC, sizeof(h->magic)) != 0 || h->version != CACHE_VERSION ||
+         names_at + h->names_size != size ) {
+        munmap(map, size);
+        map = NULL;
+        return;
+    }
+    posix_madvise(map, size, POSIX_MADV_SEQUENTIAL);
+
+    const uint32_t* c = (const uint32_t*)((const char*)map + sizeof(cache_header));
+    cols.n = n;
+    const uint32_t** col[N_UINT_COLS] = { &cols.qid, &cols.tid, &cols.ql, &cols.qs, &cols.qe,
+                                          &cols.tl, &cols.ts, &cols.te, &cols.ml, &cols.bl };
+    for ( int i = 0; i < N_UINT_COLS; i++ ) {
+        *col[i] = c + i * n;
+    }
+    cols.rev = (const uint8_t*)(c + N_UINT_COLS * n);
+
+    // index the names
+    const char* s = (const char*)map + names_at;
+    const char* e = s + h->names_size;
+    names.reserve(h->n_reads);
+    while ( s < e ) {
+        names.push_back(s);
+        s += strnlen(s, e - s) + 1;
+    }
+    if ( names.size() != h->n_reads ) {
+        munmap(map, size);
+        map = NULL;
+    }
+}
+
+overlap_cache::~overlap_cache()
+{
+    if ( map != NULL ) {
+        munmap(map, size);
+    }
+}
+
+bool overlap_cache::is_open() const
+{
+    return map != NULL;
+}
+
+const overlap_columns& overlap_cache::columns() const
+{
+    return cols;
+}
+
+uint32_t overlap_cache::n_reads() const
+{
+    return names.size();
+}
+
+const char* overlap_cache::name(uint32_t id) const
+{
+    return names[id];
+}
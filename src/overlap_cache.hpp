@@ -0,0 +1,91 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr overlap_cache -- binary, columnar copy of the overlaps of
+// a PAF file, written once and mapped by later runs
+//
+#ifndef OVERLAP_CACHE_HPP
+#define OVERLAP_CACHE_HPP
+
+#include <memory>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "readpaf/sdict.h"
+#include "paf_reader.hpp"
+
+using namespace std;
+
+// the overlaps of a PAF file, one array per column; reads are given
+// ids in the order they first appear in the file
+struct overlap_columns
+{
+    size_t n;
+    const uint32_t *qid, *tid;
+    const uint32_t *ql, *qs, *qe;
+    const uint32_t *tl, *ts, *te;
+    const uint32_t *ml, *bl;
+    const uint8_t *rev;
+};
+
+// number of overlaps of the cache filtered at a time
+static const size_t CACHE_BLOCK_SIZE = 1 << 16;
+
+// a block of overlaps of the cache, and whether each one passed the filters
+struct cache_block
+{
+    size_t id;
+    size_t b, e;
+    vector<uint8_t> keep;
+};
+
+// writes every overlap given, before any filtering, so the cache can
+// be used with any filter settings
+class cache_writer
+{
+  public:
+    cache_writer(const string& fn);
+    ~cache_writer();
+    bool is_open() const;
+
+    void add(const paf_record& r);
+    // writes the cache file; exits on write errors
+    void finish();
+
+  private:
+    string fn;
+    FILE* fp;
+    // columns are buffered, then spilled to temporary files next to the cache
+    vector<FILE*> tmp;
+    vector<vector<uint32_t>> cols;
+    vector<uint8_t> rev;
+    unique_ptr<sdict_t, void (*)(sdict_t*)> names;
+    string key;
+    uint64_t n;
+
+    void spill();
+};
+
+// maps a cache file written by cache_writer
+class overlap_cache
+{
+  public:
+    overlap_cache(const string& fn);
+    ~overlap_cache();
+    bool is_open() const;
+
+    const overlap_columns& columns() const;
+    uint32_t n_reads() const;
+    const char* name(uint32_t id) const;
+
+  private:
+    void* map;
+    size_t size;
+    overlap_columns cols;
+    vector<const char*> names;
+};
+
+#endif
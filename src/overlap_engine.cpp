@@ -0,0 +1,199 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr overlap_engine -- turns the overlaps that pass the filters
+// of one configuration into read regions and per-read coverage
+//
+#include "overlap_engine.hpp"
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+// the hint is from the size of the PAF file and counts every line, so at
+// most this many pairs are reserved; the table grows past it as it fills
+static const size_t MAX_RESERVED_PAIRS = 1 << 21;
+
+overlap_engine::overlap_engine(const overlap_config& c, read_table& r, size_t n_overlaps_hint)
+    : config(c), n_used(0), n_duplicates(0), n_off_region(0), n_trimmed(0), reads(r)
+{
+    if ( !config.keep_dups ) {
+        h.reserve(min(n_overlaps_hint, MAX_RESERVED_PAIRS));
+    }
+}
+
+void overlap_engine::add(uint32_t qid, uint32_t tid, const paf_record& r1, distribution_writer* indel_rates)
+{
+    unsigned int qlen = r1.ql, qstart = r1.qs, qend = r1.qe;
+    unsigned int tlen = r1.tl, tstart = r1.ts, tend = r1.te;
+    unsigned int match = r1.ml, al = r1.bl;
+    int omax = max(qend - qstart, tend - tstart);
+    int omin = min(qend - qstart, tend - tstart);
+
+    // record of the current overlap
+    paf_overlap o;
+    o.qid = qid, o.tid = tid;
+    o.qs = qstart, o.qe = qend, o.ts = tstart, o.te = tend;
+    o.ml = match, o.bl = al, o.rev = r1.rev;
+    o.bad = false;
+
+    // remove duplicate overlaps
+    bool replaced = false;
+    if ( !config.keep_dups ) {
+        // check if we've seen this overlap between these two reads before
+        // the pair is the same whichever read is the query
+        bool absent;
+        pair_slot* p = h.insert(qid, tid, &absent);
+        if ( !absent ) {
+            // YES, duplicate detected
+            n_duplicates++;
+            // compare the length of overlaps to get longer overlap.
+            if ( al > p->aln_len ) {
+                // prev. overlap between these 2 reads is shorter, we use the current overlap instead
+                // prev. overlap is flagged as "bad"
+                overlaps[p->index].bad = true;
+                p->aln_len = al;
+                p->index = overlaps.size();
+                replaced = true;
+            } else {
+                return;
+            }
+        } else {
+            // First time we've seen this pair
+            p->aln_len = al;
+            p->index = overlaps.size();
+        }
+    }
+
+    // adjust read length: read length = the region of read with overlaps only
+    // store region with overlap on read and init read in reads
+    // an overlap replacing a shorter duplicate does not change the regions
+    if ( !replaced ) {
+        bool success = true;
+        if ( !reads.init[qid] ) {
+            // if read not found initialize in reads
+            reads.set(qid, qlen, 0, qstart, qend);
+        } else {
+            // if read found, update the overlap info
+            success = reads.updateOvlpRgn(qid, qstart, qend);
+        }
+        if ( !reads.init[tid] ) {
+            // if read not found initialize in reads
+            reads.set(tid, tlen, 0, tstart, tend);
+        } else {
+            // if read found, update the overlap info
+            success = reads.updateOvlpRgn(tid, tstart, tend);
+        }
+
+        if ( !success ){
+            o.bad = true;
+            n_off_region++;
+            if ( indel_rates != NULL ) {
+                double indel_error_rate = (1 - double(omin)/omax);
+                indel_rates->add(indel_error_rate);
+            }
+        }
+    }
+    overlaps.push_back(o);
+}
+
+double overlap_engine::finish(distribution_writer* overlap_lengths, bool print_paf)
+{
+    h.clear(); // free up memory
+
+    // find min overlap length
+    double mino = 100000;
+
+    // use the kept overlaps, now that the overlap regions of all reads are known
+    for ( auto const& o : overlaps ) {
+        if ( o.bad ) {
+            continue;
+        }
+        uint32_t qid = o.qid, tid = o.tid;
+        unsigned int qlen = reads.read_len[qid], qstart = o.qs, qend = o.qe;
+        unsigned int tlen = reads.read_len[tid], tstart = o.ts, tend = o.te;
+        unsigned int qalen = reads.max_e[qid] - reads.min_s[qid];
+        unsigned int talen = reads.max_e[tid] - reads.min_s[tid];
+        // remove reads where the new length <<<< original length
+        if ( qalen > config.rlen_cutoff && talen > config.rlen_cutoff && double(tlen-talen)/tlen < 0.10 && double(qlen-qalen)/qlen < 0.10  ) {
+            if ( print_paf ) {
+                string s = ( o.rev ) ? "-" : "+";
+                cout << reads.name(qid) << "\t" << qalen << "\t" << qstart << "\t" << qend << "\t" << s <<"\t" << reads.name(tid) << "\t" << talen << "\t" << tstart << "\t" << tend << "\t" << o.ml << "\t"<< o.bl << "\t255\n";
+            }
+
+            // calculate softclipped regions
+            // adjust to new read length (region with overlaps only)
+            unsigned int qprefix_len = qstart - reads.min_s[qid];
+            unsigned int qsuffix_len = reads.max_e[qid] - qend;
+            unsigned int tprefix_len = tstart - reads.min_s[tid];
+            unsigned int tsuffix_len = reads.max_e[tid] - tend;
+            int left_clip = 0, right_clip = 0;
+            if ( ( qstart != 0 ) && ( tstart !=0 )) {
+                if ( !o.rev ) {
+                    left_clip += min(qprefix_len, tprefix_len);
+                } else {
+                    left_clip += min(qprefix_len, tsuffix_len);
+                }
+            }
+            if ( ( qend != 0 ) && ( tend != 0 ) ){
+                if ( !o.rev ) {
+                    right_clip += min(qsuffix_len, tsuffix_len);
+                } else {
+                    right_clip += min(qsuffix_len, tprefix_len);
+                }
+            }
+            int overhang = left_clip + right_clip;
+
+            // calculate coverage per read
+            unsigned int qoverlap_len = (qend - qstart) + overhang;
+            double qcov = double(qoverlap_len) / double(qalen);
+            reads.updateCov(qid, qcov);
+            unsigned int toverlap_len = (tend - tstart) + overhang;
+            double tcov = double(toverlap_len) / double(talen);
+            reads.updateCov(tid, tcov);
+            n_used++;
+
+            // track minimum overlap length used
+            if ( qcov < mino ) {
+                mino = qcov;
+            }
+            if ( tcov < mino ) {
+                mino = tcov;
+            }
+
+            // write to JSON overlap info
+            if ( overlap_lengths != NULL ) {
+                overlap_lengths->add(int(qoverlap_len));
+                overlap_lengths->add(int(toverlap_len));
+            }
+        } else {
+            n_trimmed++;
+        }
+    }
+    // the overlaps are not needed anymore
+    vector<paf_overlap>().swap(overlaps);
+    return mino;
+}
+
+const vector<paf_overlap>& overlap_engine::kept() const
+{
+    return overlaps;
+}
+
+void overlap_engine::restore(vector<paf_overlap>&& o)
+{
+    overlaps = move(o);
+    if ( config.keep_dups ) {
+        return;
+    }
+    // an overlap of a pair only follows an earlier one of the same pair if
+    // it replaced it, so the last overlap of each pair is the one kept
+    h.reserve(overlaps.size());
+    for ( size_t i = 0; i < overlaps.size(); i++ ) {
+        bool absent;
+        pair_slot* p = h.insert(overlaps[i].qid, overlaps[i].tid, &absent);
+        p->aln_len = overlaps[i].bl;
+        p->index = i;
+    }
+}
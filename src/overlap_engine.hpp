@@ -0,0 +1,79 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr overlap_engine -- turns the overlaps that pass the filters
+// of one configuration into read regions and per-read coverage
+//
+#ifndef OVERLAP_ENGINE_HPP
+#define OVERLAP_ENGINE_HPP
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "overlap_filter.hpp"
+#include "pair_table.hpp"
+#include "paf_reader.hpp"
+#include "read_table.hpp"
+#include "summary.hpp"
+
+using namespace std;
+
+// overlap kept while parsing the PAF file
+// coverage is calculated from it once the overlap regions of both reads are known
+struct paf_overlap
+{
+    uint32_t qid, tid;
+    unsigned int qs, qe, ts, te, ml, bl;
+    bool rev;
+    bool bad;
+};
+
+// settings that decide which overlaps are used
+struct overlap_config
+{
+    overlap_filter filter;
+    bool keep_dups;
+    unsigned int rlen_cutoff;   // also applied to the overlap regions of the reads
+};
+
+class overlap_engine
+{
+  public:
+    // per-read values are kept in reads, indexed by the read ids given to add;
+    // n_overlaps_hint is advisory, only a capped part of it is reserved
+    overlap_engine(const overlap_config& c, read_table& reads, size_t n_overlaps_hint);
+
+    // first pass: an overlap that passed the filter, in file order
+    // indel error rates of overlaps not matching the regions of their reads go to indel_rates
+    void add(uint32_t qid, uint32_t tid, const paf_record& r, distribution_writer* indel_rates);
+
+    // second pass: coverage of each read from the kept overlaps
+    // overlap lengths go to overlap_lengths; with print_paf, the overlaps
+    // used are printed to stdout; returns the minimum coverage of an overlap
+    double finish(distribution_writer* overlap_lengths, bool print_paf);
+
+    // overlaps kept so far, valid until finish
+    const vector<paf_overlap>& kept() const;
+    // carries on from overlaps kept by an earlier run, before any add;
+    // the read regions must be restored in reads as well
+    void restore(vector<paf_overlap>&& o);
+
+    const overlap_config config;
+    // overlaps used for coverage by finish
+    size_t n_used;
+    // overlaps dropped: shorter duplicates of a pair, overlaps away from
+    // the region of their reads, and overlaps of reads trimmed too much
+    size_t n_duplicates, n_off_region, n_trimmed;
+
+  private:
+    read_table& reads;
+    // store the overlaps that pass the filters, in the order of the PAF file
+    vector<paf_overlap> overlaps;
+    // store query read id + target read id pairs with the
+    // alignment length and index of the overlap kept in overlaps
+    pair_table h;
+};
+
+#endif
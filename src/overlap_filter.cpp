@@ -0,0 +1,88 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr overlap_filter -- filters that only depend on the overlap
+// itself, applied to parsed PAF lines or to cached overlap columns
+//
+#include "overlap_filter.hpp"
+
+// the filters other than self overlaps, with the comparisons combined
+// without short-circuiting
+static inline bool pass(const overlap_filter& f, uint32_t ql, uint32_t qs, uint32_t qe,
+                        uint32_t tl, uint32_t ts, uint32_t te, uint32_t ml, uint32_t bl)
+{
+    // remove overlaps with low match id, length below cutoff
+    double al_id = (double)ml/(double)bl;
+    bool low = (al_id < f.min_iden) | (ml < f.min_match) | (bl < f.min_olen) | (ql < f.min_rlen) | (tl < f.min_rlen);
+
+    // remove overlaps with high indel error rate
+    uint32_t ql_ovl = qe - qs, tl_ovl = te - ts;
+    int omax = ql_ovl > tl_ovl ? ql_ovl : tl_ovl;
+    int omin = ql_ovl < tl_ovl ? ql_ovl : tl_ovl;
+    bool indel = (1 - double(omin)/omax) > f.max_indel_rate;
+    return !(low | indel);
+}
+
+bool overlap_filter::keep(const paf_record& r) const
+{
+    // remove self overlaps
+    if ( r.qn == r.tn ) {
+        //self-overlap: query read == target read
+        return false;
+    }
+    return pass(*this, r.ql, r.qs, r.qe, r.tl, r.ts, r.te, r.ml, r.bl);
+}
+
+// the checks of pass one at a time, for an overlap pass rejected
+static filter_reason first_failed(const overlap_filter& f, uint32_t ql, uint32_t tl, uint32_t ml, uint32_t bl)
+{
+    if ( (double)ml/(double)bl < f.min_iden ) {
+        return FILTER_IDENTITY;
+    }
+    if ( ml < f.min_match ) {
+        return FILTER_MATCH;
+    }
+    if ( bl < f.min_olen ) {
+        return FILTER_OLEN;
+    }
+    if ( ql < f.min_rlen || tl < f.min_rlen ) {
+        return FILTER_RLEN;
+    }
+    return FILTER_INDEL;
+}
+
+const char* filter_reason_name(int reason)
+{
+    static const char* names[N_FILTER_REASONS] = { "kept", "self", "identity", "match", "overlap_length", "read_length", "indel_rate" };
+    return names[reason];
+}
+
+filter_reason overlap_filter::reason(const paf_record& r) const
+{
+    if ( keep(r) ) {
+        return FILTER_KEEP;
+    }
+    if ( r.qn == r.tn ) {
+        return FILTER_SELF;
+    }
+    return first_failed(*this, r.ql, r.tl, r.ml, r.bl);
+}
+
+filter_reason overlap_filter::reason(const overlap_columns& c, size_t i) const
+{
+    if ( c.qid[i] == c.tid[i] ) {
+        return FILTER_SELF;
+    }
+    if ( pass(*this, c.ql[i], c.qs[i], c.qe[i], c.tl[i], c.ts[i], c.te[i], c.ml[i], c.bl[i]) ) {
+        return FILTER_KEEP;
+    }
+    return first_failed(*this, c.ql[i], c.tl[i], c.ml[i], c.bl[i]);
+}
+
+void overlap_filter::keep_range(const overlap_columns& c, size_t b, size_t e, uint8_t* keep) const
+{
+    for ( size_t i = b; i < e; i++ ) {
+        keep[i - b] = (c.qid[i] != c.tid[i]) & pass(*this, c.ql[i], c.qs[i], c.qe[i], c.tl[i], c.ts[i], c.te[i], c.ml[i], c.bl[i]);
+    }
+}
@@ -0,0 +1,52 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr overlap_filter -- filters that only depend on the overlap
+// itself, applied to parsed PAF lines or to cached overlap columns
+//
+#ifndef OVERLAP_FILTER_HPP
+#define OVERLAP_FILTER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "paf_reader.hpp"
+#include "overlap_cache.hpp"
+
+// the first filter an overlap fails, in the order they are checked
+enum filter_reason
+{
+    FILTER_KEEP = 0,
+    FILTER_SELF,
+    FILTER_IDENTITY,
+    FILTER_MATCH,
+    FILTER_OLEN,
+    FILTER_RLEN,
+    FILTER_INDEL,
+    N_FILTER_REASONS
+};
+static_assert(N_FILTER_REASONS <= MAX_DROP_REASONS, "the reader counts fewer drop reasons");
+
+// name of a reason in the metrics
+const char* filter_reason_name(int reason);
+
+struct overlap_filter
+{
+    double min_iden;
+    unsigned int min_match;
+    unsigned int min_olen;
+    unsigned int min_rlen;
+    double max_indel_rate;
+
+    // self overlaps are always removed
+    bool keep(const paf_record& r) const;
+    // keep[i - b] for overlaps b..e-1 of the columns; the loop has no
+    // branches, so the compiler can vectorise it
+    void keep_range(const overlap_columns& c, size_t b, size_t e, uint8_t* keep) const;
+    // the first filter an overlap fails, FILTER_KEEP for the overlaps kept
+    filter_reason reason(const paf_record& r) const;
+    filter_reason reason(const overlap_columns& c, size_t i) const;
+};
+
+#endif
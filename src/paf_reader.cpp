@@ -0,0 +1,279 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr paf_reader -- reads PAF file in line-aligned chunks,
+// parsing and filtering the chunks on worker threads
+//
+#include "paf_reader.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+// amount of text read from the PAF file for each chunk
+static const size_t CHUNK_SIZE = 1 << 23;
+
+// number of columns of a PAF line parsed, up to the alignment block length
+static const int N_COLUMNS = 11;
+
+bool name_slice::operator==(const name_slice& n) const
+{
+    return l == n.l && memcmp(s, n.s, l) == 0;
+}
+
+// finds the tabs and newlines of a text, 16 bytes at a time
+class delim_scanner
+{
+  public:
+    delim_scanner(const char* b, const char* e) : block(b), end(e), mask(0)
+    {
+        load();
+    }
+
+    // position of the next tab or newline, end if there is none
+    const char* next()
+    {
+        while ( mask == 0 ) {
+            block += 16;
+            if ( block >= end ) {
+                return end;
+            }
+            load();
+        }
+        const char* p = block + __builtin_ctz(mask);
+        mask &= mask - 1;
+        return p;
+    }
+
+    // carries on from p
+    void reset(const char* p)
+    {
+        block = p;
+        load();
+    }
+
+  private:
+    const char* block;
+    const char* end;
+    uint32_t mask;  // delimiters in block not returned yet
+
+    void load()
+    {
+        mask = 0;
+        if ( block >= end ) {
+            return;
+        }
+#if defined(__SSE2__)
+        if ( end - block >= 16 ) {
+            __m128i v = _mm_loadu_si128((const __m128i*)block);
+            __m128i d = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+            mask = _mm_movemask_epi8(d);
+            return;
+        }
+#endif
+        for ( int i = 0; i < 16 && block + i < end; i++ ) {
+            if ( block[i] == '\t' || block[i] == '\n' ) {
+                mask |= 1u << i;
+            }
+        }
+    }
+};
+
+// leading digits of [s, e) as an unsigned integer
+static inline uint32_t parse_uint(const char* s, const char* e)
+{
+    uint32_t v = 0;
+    while ( s < e && (unsigned char)(*s - '0') < 10 ) {
+        v = v * 10 + (*s - '0');
+        s++;
+    }
+    return v;
+}
+
+paf_reader::paf_reader(const string& fn, unsigned int n_threads, function<int(const paf_record&)> d)
+    : drop(d), n_lines(0), dropped(), eof(false), map(NULL), map_size(0), map_pos(0)
+{
+    // BGZF is inflated on the worker threads as well
+    fp = in_open(fn.c_str(), n_threads);
+    if ( fp == 0 ) {
+        return;
+    }
+    map = in_mmap(fp, &map_size);
+    if ( map != NULL ) {
+        pipeline.reset(new chunk_pipeline<paf_chunk>(n_threads,
+            [this](paf_chunk* c) { return map_chunk(c); },
+            [this](paf_chunk* c) { parse_chunk(c); }));
+    } else {
+        pipeline.reset(new chunk_pipeline<paf_chunk>(n_threads,
+            [this](paf_chunk* c) { return read_chunk(c); },
+            [this](paf_chunk* c) { parse_chunk(c); }));
+    }
+}
+
+paf_reader::~paf_reader()
+{
+    // stop the worker threads before closing the file
+    pipeline.reset();
+    if ( fp != 0 ) {
+        in_close(fp);
+    }
+}
+
+bool paf_reader::is_open() const
+{
+    return fp != 0;
+}
+
+paf_chunk* paf_reader::next()
+{
+    paf_chunk* c = pipeline->next();
+    if ( c != NULL ) {
+        n_lines += c->n_lines;
+        for ( int i = 0; i < MAX_DROP_REASONS; i++ ) {
+            dropped[i] += c->n_dropped[i];
+        }
+    }
+    return c;
+}
+
+void paf_reader::release(paf_chunk* c)
+{
+    pipeline->release(c);
+}
+
+input_metrics paf_reader::metrics()
+{
+    input_metrics m;
+    in_stats(fp, &m.bytes_read, &m.bytes_uncompressed);
+    m.records = n_lines;
+    m.busy = pipeline->busy_times();
+    m.cpu_time = pipeline->cpu_time();
+    return m;
+}
+
+uint64_t paf_reader::n_dropped(int reason) const
+{
+    return dropped[reason];
+}
+
+bool paf_reader::read_chunk(paf_chunk* c)
+{
+    // start with the partial line left over from the previous chunk
+    c->data.swap(carry);
+    carry.clear();
+    c->records.clear();
+    while ( !eof ) {
+        size_t l = c->data.size();
+        c->data.resize(l + CHUNK_SIZE);
+        int n = in_read(fp, c->data.data() + l, CHUNK_SIZE);
+        if ( n < 0 ) {
+            fprintf(stderr, "ERROR: failed to read PAF file. Check to see if it is truncated or corrupted.\n\n");
+            exit(EXIT_FAILURE);
+        }
+        c->data.resize(l + n);
+        if ( n == 0 ) {
+            eof = true;
+            break;
+        }
+        // keep the partial last line for the next chunk
+        size_t e = c->data.size();
+        while ( e > l && c->data[e-1] != '\n' ) {
+            e--;
+        }
+        if ( e > l ) {
+            carry.assign(c->data.begin() + e, c->data.end());
+            c->data.resize(e);
+            break;
+        }
+        // no complete line in this block yet, keep reading
+    }
+    c->begin = c->data.data();
+    c->end = c->begin + c->data.size();
+    return !c->data.empty();
+}
+
+bool paf_reader::map_chunk(paf_chunk* c)
+{
+    // the next CHUNK_SIZE bytes of the mapped file, up to the end of a line
+    c->records.clear();
+    if ( map_pos >= map_size ) {
+        return false;
+    }
+    size_t e = min(map_pos + CHUNK_SIZE, map_size);
+    if ( e < map_size ) {
+        const char* nl = (const char*)memchr(map + e, '\n', map_size - e);
+        e = nl != NULL ? nl - map + 1 : map_size;
+    }
+    c->begin = map + map_pos;
+    c->end = map + e;
+    map_pos = e;
+    return true;
+}
+
+void paf_reader::parse_chunk(paf_chunk* c)
+{
+    // only the first N_COLUMNS columns are parsed; the columns are
+    // read in place, so the text is never copied or modified
+    delim_scanner scanner(c->begin, c->end);
+    const char* s = c->begin;
+    paf_record r;
+    c->n_lines = 0;
+    memset(c->n_dropped, 0, sizeof(c->n_dropped));
+    while ( s < c->end ) {
+        // delim[k] is the tab or newline ending column k
+        const char* delim[N_COLUMNS];
+        int t = 0;
+        const char* d = s;
+        while ( t < N_COLUMNS ) {
+            d = scanner.next();
+            delim[t++] = d;
+            if ( d == c->end || *d == '\n' ) {
+                break;
+            }
+        }
+        // skip the rest of a line with more columns
+        const char* e = d;
+        if ( e < c->end && *e != '\n' ) {
+            e = (const char*)memchr(d, '\n', c->end - d);
+            if ( e == NULL ) {
+                e = c->end;
+            } else {
+                scanner.reset(e + 1);
+            }
+        }
+        const char* line = s;
+        s = e + 1;
+
+        // lines with fewer than 10 columns are skipped
+        if ( t < 10 ) {
+            continue;
+        }
+        // a number ends at the first character that is not a digit, so
+        // the delimiters (and a '\r' before the newline) end the columns
+        r.qn.s = line, r.qn.l = delim[0] - line;
+        r.ql = parse_uint(delim[0] + 1, delim[1]);
+        r.qs = parse_uint(delim[1] + 1, delim[2]);
+        r.qe = parse_uint(delim[2] + 1, delim[3]);
+        r.rev = delim[3][1] == '-';
+        r.tn.s = delim[4] + 1, r.tn.l = delim[5] - delim[4] - 1;
+        r.tl = parse_uint(delim[5] + 1, delim[6]);
+        r.ts = parse_uint(delim[6] + 1, delim[7]);
+        r.te = parse_uint(delim[7] + 1, delim[8]);
+        r.ml = parse_uint(delim[8] + 1, delim[9]);
+        // the block length is 0 if missing
+        r.bl = t > 10 ? parse_uint(delim[9] + 1, delim[10]) : 0;
+        c->n_lines++;
+        int reason = drop(r);
+        if ( reason == 0 ) {
+            c->records.push_back(r);
+        } else {
+            c->n_dropped[reason]++;
+        }
+    }
+}
@@ -0,0 +1,91 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr paf_reader -- reads PAF file in line-aligned chunks,
+// parsing and filtering the chunks on worker threads
+//
+#ifndef PAF_READER_HPP
+#define PAF_READER_HPP
+
+#include <functional>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "input.h"
+#include "chunk_pipeline.hpp"
+#include "metrics.hpp"
+
+using namespace std;
+
+// reasons a record can be dropped for, 1 to MAX_DROP_REASONS - 1
+static const int MAX_DROP_REASONS = 8;
+
+// read name in the PAF text, not NUL terminated
+struct name_slice
+{
+    const char* s;
+    uint32_t l;
+
+    bool operator==(const name_slice& n) const;
+};
+
+// the columns of a PAF line used by preqclr
+struct paf_record
+{
+    name_slice qn, tn;
+    uint32_t ql, qs, qe, tl, ts, te, ml, bl;
+    bool rev;
+};
+
+// a range of complete PAF lines and the overlaps parsed from it
+// record names point into the text, so they are valid until the chunk is released
+struct paf_chunk
+{
+    size_t id;
+    const char* begin;      // text of the chunk, in data or in the mapped file
+    const char* end;
+    vector<char> data;
+    vector<paf_record> records;
+    uint64_t n_lines;                       // records parsed, kept or not
+    uint64_t n_dropped[MAX_DROP_REASONS];   // records dropped, by reason
+};
+
+class paf_reader
+{
+  public:
+    // drop decides which parsed overlaps are stored in the chunks: it
+    // returns 0 to keep an overlap, or the reason it is dropped for
+    // uncompressed files are mapped and split into byte ranges, without copying
+    paf_reader(const string& fn, unsigned int n_threads, function<int(const paf_record&)> drop);
+    ~paf_reader();
+    bool is_open() const;
+
+    // next chunk in file order, NULL once the file is read
+    paf_chunk* next();
+    void release(paf_chunk* c);
+
+    // input read so far, with the records of the chunks handed out
+    input_metrics metrics();
+    // records of the chunks handed out dropped for reason
+    uint64_t n_dropped(int reason) const;
+
+  private:
+    in_file_t* fp;
+    function<int(const paf_record&)> drop;
+    uint64_t n_lines;
+    uint64_t dropped[MAX_DROP_REASONS];
+    vector<char> carry;  // partial line at the end of the last block read
+    bool eof;
+    const char* map;     // mapped file, NULL when the file is read in blocks
+    size_t map_size, map_pos;
+    unique_ptr<chunk_pipeline<paf_chunk>> pipeline;
+
+    bool read_chunk(paf_chunk* c);
+    bool map_chunk(paf_chunk* c);
+    void parse_chunk(paf_chunk* c);
+};
+
+#endif
@@ -0,0 +1,94 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr pair_table -- open-addressing hash table keyed on pairs
+// of read ids, used to find duplicate overlaps
+//
+#include "pair_table.hpp"
+
+using namespace std;
+
+// no pair of read ids has both ids set to UINT32_MAX
+static const uint64_t EMPTY_KEY = UINT64_MAX;
+
+// slots are never more than 70% used
+static inline size_t max_used(size_t n_slots)
+{
+    return n_slots / 10 * 7;
+}
+
+// finalizer of splitmix64, spreads the read ids over all the bits
+static inline uint64_t hash_key(uint64_t k)
+{
+    k = (k ^ (k >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    k = (k ^ (k >> 27)) * 0x94d049bb133111ebULL;
+    return k ^ (k >> 31);
+}
+
+pair_table::pair_table() : n_used(0), mask(0)
+{
+}
+
+void pair_table::reserve(size_t n)
+{
+    size_t n_slots = 16;
+    while ( max_used(n_slots) < n ) {
+        n_slots <<= 1;
+    }
+    if ( n_slots > slots.size() ) {
+        resize(n_slots);
+    }
+}
+
+void pair_table::resize(size_t n_slots)
+{
+    vector<pair_slot> old;
+    old.swap(slots);
+    pair_slot empty = { EMPTY_KEY, 0, 0 };
+    slots.assign(n_slots, empty);
+    mask = n_slots - 1;
+    for ( auto const& s : old ) {
+        if ( s.key == EMPTY_KEY ) {
+            continue;
+        }
+        uint64_t i = hash_key(s.key) & mask;
+        while ( slots[i].key != EMPTY_KEY ) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = s;
+    }
+}
+
+pair_slot* pair_table::insert(uint32_t a, uint32_t b, bool* absent)
+{
+    if ( n_used >= max_used(slots.size()) ) {
+        resize(slots.empty() ? 16 : slots.size() << 1);
+    }
+    uint64_t key = a < b ? (uint64_t)a << 32 | b : (uint64_t)b << 32 | a;
+    uint64_t i = hash_key(key) & mask;
+    // linear probing: stop at the pair or at the first empty slot
+    while ( slots[i].key != EMPTY_KEY && slots[i].key != key ) {
+        i = (i + 1) & mask;
+    }
+    *absent = slots[i].key == EMPTY_KEY;
+    if ( *absent ) {
+        slots[i].key = key;
+        slots[i].index = 0;
+        slots[i].aln_len = 0;
+        n_used++;
+    }
+    return &slots[i];
+}
+
+size_t pair_table::size() const
+{
+    return n_used;
+}
+
+void pair_table::clear()
+{
+    vector<pair_slot>().swap(slots);
+    n_used = 0;
+    mask = 0;
+}
@@ -0,0 +1,45 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr pair_table -- open-addressing hash table keyed on pairs
+// of read ids, used to find duplicate overlaps
+//
+#ifndef PAIR_TABLE_HPP
+#define PAIR_TABLE_HPP
+
+#include <stdint.h>
+#include <vector>
+
+using namespace std;
+
+// best overlap seen between two reads
+struct pair_slot
+{
+    uint64_t key;       // smaller read id in the high bits, larger in the low bits
+    uint64_t index;     // index of the overlap kept
+    uint32_t aln_len;   // alignment block length of the overlap kept
+};
+
+class pair_table
+{
+  public:
+    pair_table();
+
+    // make room for n pairs without growing the table
+    void reserve(size_t n);
+    // slot of the pair of reads a and b, in either order
+    // a new slot is added if absent is set; it is valid until the next insert
+    pair_slot* insert(uint32_t a, uint32_t b, bool* absent);
+    size_t size() const;
+    void clear();
+
+  private:
+    vector<pair_slot> slots;
+    size_t n_used;
+    uint64_t mask;
+
+    void resize(size_t n_slots);
+};
+
+#endif
@@ -0,0 +1,241 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr qc_state -- what a run keeps of its reads and overlaps,
+// saved so that a later run only reads the new reads and overlaps,
+// and partial results of shards of the input, merged into one report
+//
+#include "qc_state.hpp"
+#include <stdio.h>
+#include <string.h>
+
+using namespace std;
+
+// file layouts, in native byte order:
+//   magic, version
+//   settings
+//   arrays, each as a uint64_t count then the values:
+//     fq records, dust_scores, low_complexity
+//     state: indel_rates, read_len, min_s, max_e, init, overlaps
+//     partial: overlaps
+//   read names in id order, each NUL terminated
+static const char STATE_MAGIC[8] = { 'P', 'Q', 'L', 'R', 'S', 'T', 'A', 0 };
+static const char PARTIAL_MAGIC[8] = { 'P', 'Q', 'L', 'R', 'P', 'R', 'T', 0 };
+static const uint32_t STATE_VERSION = 1;
+
+template<typename T>
+static bool put(FILE* fp, const T& v)
+{
+    return fwrite(&v, sizeof(T), 1, fp) == 1;
+}
+
+template<typename T>
+static bool put_array(FILE* fp, const vector<T>& v)
+{
+    uint64_t n = v.size();
+    return put(fp, n) && fwrite(v.data(), sizeof(T), n, fp) == n;
+}
+
+template<typename T>
+static bool get(FILE* fp, T* v)
+{
+    return fread(v, sizeof(T), 1, fp) == 1;
+}
+
+template<typename T>
+static bool get_array(FILE* fp, vector<T>* v)
+{
+    uint64_t n;
+    if ( !get(fp, &n) ) {
+        return false;
+    }
+    v->resize(n);
+    return fread(v->data(), sizeof(T), n, fp) == n;
+}
+
+static bool put_header(FILE* fp, const char* magic, const qc_settings& s)
+{
+    const overlap_config& c = s.config;
+    return fwrite(magic, 1, sizeof(STATE_MAGIC), fp) == sizeof(STATE_MAGIC) && put(fp, STATE_VERSION) &&
+           put(fp, c.filter.min_iden) && put(fp, c.filter.min_match) && put(fp, c.filter.min_olen) &&
+           put(fp, c.filter.min_rlen) && put(fp, c.filter.max_indel_rate) && put(fp, c.keep_dups) &&
+           put(fp, c.rlen_cutoff) && put(fp, s.sample_fraction) && put(fp, s.sample_seed) &&
+           put(fp, s.dust_window);
+}
+
+static bool get_header(FILE* fp, const char* magic, qc_settings* s)
+{
+    overlap_config& c = s->config;
+    char m[sizeof(STATE_MAGIC)];
+    uint32_t version;
+    return fread(m, 1, sizeof(m), fp) == sizeof(m) && memcmp(m, magic, sizeof(m)) == 0 &&
+           get(fp, &version) && version == STATE_VERSION &&
+           get(fp, &c.filter.min_iden) && get(fp, &c.filter.min_match) && get(fp, &c.filter.min_olen) &&
+           get(fp, &c.filter.min_rlen) && get(fp, &c.filter.max_indel_rate) && get(fp, &c.keep_dups) &&
+           get(fp, &c.rlen_cutoff) && get(fp, &s->sample_fraction) && get(fp, &s->sample_seed) &&
+           get(fp, &s->dust_window);
+}
+
+static bool put_fq(FILE* fp, const fq_values& fq)
+{
+    return put_array(fp, fq.records) && put_array(fp, fq.dust_scores) && put_array(fp, fq.low_complexity);
+}
+
+static bool get_fq(FILE* fp, fq_values* fq)
+{
+    return get_array(fp, &fq->records) && get_array(fp, &fq->dust_scores) && get_array(fp, &fq->low_complexity);
+}
+
+static bool put_names(FILE* fp, const read_table& names)
+{
+    bool ok = true;
+    for ( uint32_t id = 0; ok && id < names.n_ids(); id++ ) {
+        ok = fputs(names.name(id), fp) >= 0 && fputc(0, fp) == 0;
+    }
+    return ok;
+}
+
+// interns n names in id order, so they get their old ids back; false
+// unless the names are all that is left of the file
+static bool get_names(FILE* fp, size_t n, read_table* names)
+{
+    string name;
+    int c;
+    while ( names->n_ids() < n && (c = fgetc(fp)) != EOF ) {
+        if ( c != 0 ) {
+            name += c;
+            continue;
+        }
+        if ( names->intern(name.c_str()) + 1 != names->n_ids() ) {
+            return false;
+        }
+        name.clear();
+    }
+    return names->n_ids() == n && fgetc(fp) == EOF;
+}
+
+// writes to fn.tmp, then renames it, as fn may be the file being resumed
+static FILE* open_tmp(const string& fn)
+{
+    return fopen((fn + ".tmp").c_str(), "wb");
+}
+
+static bool close_tmp(const string& fn, FILE* fp, bool ok)
+{
+    string tmp = fn + ".tmp";
+    ok = fclose(fp) == 0 && ok;
+    if ( !ok || rename(tmp.c_str(), fn.c_str()) != 0 ) {
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool same_settings(const qc_settings& a, const qc_settings& b)
+{
+    const overlap_filter& f = a.config.filter;
+    const overlap_filter& g = b.config.filter;
+    return f.min_iden == g.min_iden && f.min_match == g.min_match && f.min_olen == g.min_olen &&
+           f.min_rlen == g.min_rlen && f.max_indel_rate == g.max_indel_rate &&
+           a.config.keep_dups == b.config.keep_dups && a.config.rlen_cutoff == b.config.rlen_cutoff &&
+           a.sample_fraction == b.sample_fraction && a.sample_seed == b.sample_seed &&
+           a.dust_window == b.dust_window;
+}
+
+bool save_state(const string& fn, const qc_state& s, const read_table& reads, const vector<paf_overlap>& overlaps)
+{
+    FILE* fp = open_tmp(fn);
+    if ( fp == NULL ) {
+        return false;
+    }
+    bool ok = put_header(fp, STATE_MAGIC, s.settings) && put_fq(fp, s.fq) && put_array(fp, s.indel_rates);
+    ok = ok && put_array(fp, reads.read_len) && put_array(fp, reads.min_s) &&
+         put_array(fp, reads.max_e) && put_array(fp, reads.init) && put_array(fp, overlaps);
+    ok = ok && put_names(fp, reads);
+    return close_tmp(fn, fp, ok);
+}
+
+bool load_state(const string& fn, qc_state* s)
+{
+    FILE* fp = fopen(fn.c_str(), "rb");
+    if ( fp == NULL ) {
+        return false;
+    }
+    bool ok = get_header(fp, STATE_MAGIC, &s->settings) && get_fq(fp, &s->fq) && get_array(fp, &s->indel_rates);
+    vector<uint32_t> read_len;
+    vector<int> min_s, max_e;
+    vector<uint8_t> init;
+    ok = ok && get_array(fp, &read_len) && get_array(fp, &min_s) && get_array(fp, &max_e) &&
+         get_array(fp, &init) && get_array(fp, &s->overlaps);
+    ok = ok && min_s.size() == read_len.size() && max_e.size() == read_len.size() && init.size() == read_len.size();
+    s->reads = read_table();
+    ok = ok && get_names(fp, read_len.size(), &s->reads);
+    fclose(fp);
+
+    // coverage is calculated again from the overlaps
+    for ( uint32_t id = 0; ok && id < read_len.size(); id++ ) {
+        if ( init[id] ) {
+            s->reads.set(id, read_len[id], 0, min_s[id], max_e[id]);
+        }
+    }
+    // overlaps must refer to the reads of the state
+    for ( size_t i = 0; ok && i < s->overlaps.size(); i++ ) {
+        ok = s->overlaps[i].qid < read_len.size() && s->overlaps[i].tid < read_len.size();
+    }
+    return ok;
+}
+
+void qc_partial::add(const paf_record& r)
+{
+    partial_overlap o;
+    o.qid = names.intern(r.qn.s, r.qn.l);
+    o.tid = names.intern(r.tn.s, r.tn.l);
+    o.ql = r.ql, o.qs = r.qs, o.qe = r.qe;
+    o.tl = r.tl, o.ts = r.ts, o.te = r.te;
+    o.ml = r.ml, o.bl = r.bl, o.rev = r.rev;
+    overlaps.push_back(o);
+}
+
+paf_record qc_partial::record(size_t i) const
+{
+    const partial_overlap& o = overlaps[i];
+    paf_record r;
+    r.qn.s = r.tn.s = NULL;
+    r.qn.l = r.tn.l = 0;
+    r.ql = o.ql, r.qs = o.qs, r.qe = o.qe;
+    r.tl = o.tl, r.ts = o.ts, r.te = o.te;
+    r.ml = o.ml, r.bl = o.bl, r.rev = o.rev;
+    return r;
+}
+
+bool save_partial(const string& fn, const qc_partial& p)
+{
+    FILE* fp = open_tmp(fn);
+    if ( fp == NULL ) {
+        return false;
+    }
+    uint64_t n_names = p.names.n_ids();
+    bool ok = put_header(fp, PARTIAL_MAGIC, p.settings) && put_fq(fp, p.fq) &&
+              put_array(fp, p.overlaps) && put(fp, n_names) && put_names(fp, p.names);
+    return close_tmp(fn, fp, ok);
+}
+
+bool load_partial(const string& fn, qc_partial* p, bool with_overlaps)
+{
+    FILE* fp = fopen(fn.c_str(), "rb");
+    if ( fp == NULL ) {
+        return false;
+    }
+    bool ok = get_header(fp, PARTIAL_MAGIC, &p->settings) && get_fq(fp, &p->fq);
+    if ( with_overlaps ) {
+        uint64_t n_names;
+        p->names = read_table();
+        ok = ok && get_array(fp, &p->overlaps) && get(fp, &n_names) && get_names(fp, n_names, &p->names);
+        for ( size_t i = 0; ok && i < p->overlaps.size(); i++ ) {
+            ok = p->overlaps[i].qid < n_names && p->overlaps[i].tid < n_names;
+        }
+    }
+    fclose(fp);
+    return ok;
+}
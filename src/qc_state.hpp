@@ -0,0 +1,85 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr qc_state -- what a run keeps of its reads and overlaps,
+// saved so that a later run only reads the new reads and overlaps,
+// and partial results of shards of the input, merged into one report
+//
+#ifndef QC_STATE_HPP
+#define QC_STATE_HPP
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "overlap_engine.hpp"
+#include "paf_reader.hpp"
+#include "read_table.hpp"
+
+using namespace std;
+
+// settings the saved values were calculated with; runs using them must use the same
+struct qc_settings
+{
+    overlap_config config;
+    double sample_fraction;
+    uint64_t sample_seed;
+    unsigned int dust_window;
+};
+
+// values calculated from the reads file, in file order
+struct fq_values
+{
+    vector<pair<double, int>> records;  // GC content (0 if not sampled) and length of each read
+    vector<double> dust_scores;         // of the sampled reads
+    vector<double> low_complexity;      // of the sampled reads, with a DUST window
+};
+
+struct qc_state
+{
+    qc_settings settings;
+    fq_values fq;
+    // PAF file: indel error rates written so far, then the read regions
+    // and overlaps kept, before coverage is calculated
+    vector<double> indel_rates;
+    read_table reads;
+    vector<paf_overlap> overlaps;
+};
+
+// overlap of a shard that passed the filters, with the ids of the shard's names
+struct partial_overlap
+{
+    uint32_t qid, tid;
+    uint32_t ql, qs, qe, tl, ts, te, ml, bl;
+    uint8_t rev;
+};
+
+// results of one shard of the reads and PAF files; the overlaps are
+// used when the shards are merged, as coverage needs all of them
+struct qc_partial
+{
+    qc_settings settings;
+    fq_values fq;
+    read_table names;
+    vector<partial_overlap> overlaps;
+
+    void add(const paf_record& r);
+    // overlap i as a record, without its names
+    paf_record record(size_t i) const;
+};
+
+bool same_settings(const qc_settings& a, const qc_settings& b);
+
+// reads and overlaps are given apart, as they belong to the run
+// the whole state is written to fn.tmp, then renamed to fn; returns false on errors
+bool save_state(const string& fn, const qc_state& s, const read_table& reads, const vector<paf_overlap>& overlaps);
+// returns false if fn cannot be read or is not a state file
+bool load_state(const string& fn, qc_state* s);
+
+bool save_partial(const string& fn, const qc_partial& p);
+// without with_overlaps, only the settings and reads file values are read
+bool load_partial(const string& fn, qc_partial* p, bool with_overlaps);
+
+#endif
@@ -0,0 +1,93 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr read_table -- holds read information calculated from overlaps
+// read names are interned once, the per-read values are stored in
+// flat arrays indexed by read id
+//
+#include "read_table.hpp"
+
+using namespace std;
+
+read_table::read_table() : names(sd_init(), sd_destroy), n_init(0)
+{
+}
+
+uint32_t read_table::intern(const char* name)
+{
+    uint32_t id = sd_put(names.get(), name, 0);
+    if ( id == read_len.size() ) {
+        // first time we see this read
+        read_len.push_back(0);
+        cov.push_back(0);
+        min_s.push_back(0);
+        max_e.push_back(0);
+        init.push_back(0);
+    }
+    return id;
+}
+
+uint32_t read_table::intern(const char* name, uint32_t l)
+{
+    key.assign(name, l);
+    return intern(key.c_str());
+}
+
+void read_table::resize(uint32_t n)
+{
+    if ( n > read_len.size() ) {
+        read_len.resize(n, 0);
+        cov.resize(n, 0);
+        min_s.resize(n, 0);
+        max_e.resize(n, 0);
+        init.resize(n, 0);
+    }
+}
+
+const char* read_table::name(uint32_t id) const
+{
+    return names->seq[id].name;
+}
+
+uint32_t read_table::n_ids() const
+{
+    return read_len.size();
+}
+
+size_t read_table::size() const
+{
+    return n_init;
+}
+
+void read_table::set(uint32_t id, uint32_t l, double c, int s, int e)
+{
+    if ( !init[id] ) {
+        init[id] = 1;
+        n_init++;
+    }
+    read_len[id] = l;
+    cov[id] = c;
+    min_s[id] = s;
+    max_e[id] = e;
+}
+
+void read_table::updateCov(uint32_t id, double c)
+{
+    cov[id] += c;
+}
+
+bool read_table::updateOvlpRgn(uint32_t id, int s, int e)
+{
+    if ( (s < (max_e[id] + 200)) && (min_s[id] < (e + 200)) ) {
+        if ( e > max_e[id] ) {
+            max_e[id] = e;
+        }
+        if ( s < min_s[id] ) {
+            min_s[id] = s;
+        }
+        return true;
+    } else {
+        return false;
+    }
+}
@@ -0,0 +1,62 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr read_table -- holds read information calculated from overlaps
+// read names are interned once, the per-read values are stored in
+// flat arrays indexed by read id
+//
+#ifndef READ_TABLE_HPP
+#define READ_TABLE_HPP
+
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "readpaf/sdict.h"
+
+using namespace std;
+
+class read_table
+{
+  public:
+    read_table();
+    // the table is only moved, never copied
+    read_table(read_table&&) = default;
+    read_table& operator=(read_table&&) = default;
+    read_table(const read_table&) = delete;
+    read_table& operator=(const read_table&) = delete;
+
+    // id of the read name, a new id is given to names not seen before
+    uint32_t intern(const char* name);
+    // same, for a name of l characters that is not NUL terminated
+    uint32_t intern(const char* name, uint32_t l);
+    const char* name(uint32_t id) const;
+    // number of read ids, the read names interned or the size given to resize
+    uint32_t n_ids() const;
+    // number of reads with an overlap region
+    size_t size() const;
+
+    // grows the per-read values to n ids, for a table indexed by the
+    // ids of another table's names
+    void resize(uint32_t n);
+
+    void set(uint32_t id, uint32_t l, double c, int s, int e);
+    void updateCov(uint32_t id, double c);
+    bool updateOvlpRgn(uint32_t id, int s, int e);
+
+    // per-read values, only valid where init[id] is set
+    vector<uint32_t> read_len;
+    vector<double> cov;
+    vector<int> min_s;
+    vector<int> max_e;
+    vector<uint8_t> init;
+
+  private:
+    unique_ptr<sdict_t, void (*)(sdict_t*)> names;
+    size_t n_init;
+    string key;     // NUL terminated copy of the name being interned
+};
+
+#endif
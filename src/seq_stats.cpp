@@ -0,0 +1,81 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr seq_stats -- base composition kernels over raw sequence bytes
+//
+#include "seq_stats.hpp"
+#include <map>
+#include <math.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+size_t count_gc(const char* s, size_t n)
+{
+    size_t gc = 0;
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i G = _mm256_set1_epi8('G');
+    const __m256i C = _mm256_set1_epi8('C');
+    const __m256i zero = _mm256_setzero_si256();
+    while ( i + 32 <= n ) {
+        // per-byte counters hold at most 255 blocks before being summed
+        __m256i acc = _mm256_setzero_si256();
+        for ( int k = 0; k < 255 && i + 32 <= n; k++, i += 32 ) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(s + i));
+            __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v, G), _mm256_cmpeq_epi8(v, C));
+            acc = _mm256_sub_epi8(acc, m);
+        }
+        __m256i sums = _mm256_sad_epu8(acc, zero);
+        gc += _mm256_extract_epi64(sums, 0) + _mm256_extract_epi64(sums, 1)
+            + _mm256_extract_epi64(sums, 2) + _mm256_extract_epi64(sums, 3);
+    }
+#elif defined(__SSE2__)
+    const __m128i G = _mm_set1_epi8('G');
+    const __m128i C = _mm_set1_epi8('C');
+    const __m128i zero = _mm_setzero_si128();
+    while ( i + 16 <= n ) {
+        // per-byte counters hold at most 255 blocks before being summed
+        __m128i acc = _mm_setzero_si128();
+        for ( int k = 0; k < 255 && i + 16 <= n; k++, i += 16 ) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+            __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, G), _mm_cmpeq_epi8(v, C));
+            acc = _mm_sub_epi8(acc, m);
+        }
+        __m128i sums = _mm_sad_epu8(acc, zero);
+        gc += _mm_cvtsi128_si32(sums) + _mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+    }
+#endif
+    for ( ; i < n; i++ ) {
+        gc += s[i] == 'G' || s[i] == 'C';
+    }
+    return gc;
+}
+
+double peak_gc_content(const std::vector<std::pair<double, int>>& fq)
+{
+    std::map<double, int> freq; // store counts for each GC content
+    int max = 0;
+    double mode = 0.0;
+    for ( auto const& r : fq ) {
+        if ( r.first == 0 ) {
+            continue;
+        }
+        double v = round(r.first * 10.0) / 10.0;
+        auto i = freq.find(v);
+        if ( i == freq.end() ) {
+            freq.insert(std::make_pair(v, 1));
+        } else {
+            i->second += 1;
+            if ( i->second > max ) {
+                max = i->second;
+                mode = i->first;
+            }
+        }
+    }
+    return mode;
+}
@@ -0,0 +1,21 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr seq_stats -- base composition kernels over raw sequence bytes
+//
+#ifndef SEQ_STATS_HPP
+#define SEQ_STATS_HPP
+
+#include <stddef.h>
+#include <utility>
+#include <vector>
+
+// number of 'G' and 'C' bases in s[0..n)
+size_t count_gc(const char* s, size_t n);
+
+// most common GC content, to 0.1, of (GC content, length) read records;
+// reads that were not sampled have a GC content of 0 and are skipped
+double peak_gc_content(const std::vector<std::pair<double, int>>& fq);
+
+#endif
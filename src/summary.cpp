@@ -0,0 +1,301 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr summary -- histograms and quantile sketches used to
+// summarise distributions instead of writing every value
+//
+#include "summary.hpp"
+#include <math.h>
+#include <stdio.h>
+
+using namespace std;
+
+// adds n to the count at index b of counts starting at index offset,
+// growing counts on either side as needed
+static void add_count(vector<uint64_t>& counts, int& offset, int b, uint64_t n)
+{
+    if ( counts.empty() ) {
+        offset = b;
+        counts.push_back(0);
+    } else if ( b < offset ) {
+        counts.insert(counts.begin(), offset - b, 0);
+        offset = b;
+    } else if ( b >= offset + (int)counts.size() ) {
+        counts.resize(b - offset + 1, 0);
+    }
+    counts[b - offset] += n;
+}
+
+static void write_counts(json_writer* writer, const vector<uint64_t>& counts)
+{
+    writer->StartArray();
+    for ( auto const& c : counts ) {
+        writer->Uint64(c);
+    }
+    writer->EndArray();
+}
+
+histogram::histogram(scale_t s, double w) : scale(s), width(w), offset(0), zeros(0)
+{
+}
+
+histogram histogram::linear(double width)
+{
+    return histogram(LINEAR, width);
+}
+
+histogram histogram::log(unsigned int bins_per_decade)
+{
+    return histogram(LOG, 1.0 / bins_per_decade);
+}
+
+int histogram::bin(double v) const
+{
+    if ( scale == LOG ) {
+        return int(floor(log10(v) / width));
+    }
+    return int(floor(v / width));
+}
+
+void histogram::add(double v, uint64_t n)
+{
+    if ( v == 0 || ( scale == LOG && v < 0 ) ) {
+        zeros += n;
+        return;
+    }
+    add_count(counts, offset, bin(v), n);
+}
+
+void histogram::merge(const histogram& h)
+{
+    for ( size_t i = 0; i < h.counts.size(); i++ ) {
+        if ( h.counts[i] > 0 ) {
+            add_count(counts, offset, h.offset + int(i), h.counts[i]);
+        }
+    }
+    zeros += h.zeros;
+}
+
+void histogram::write(json_writer* writer) const
+{
+    writer->StartObject();
+    writer->Key("scale");
+    writer->String(scale == LOG ? "log" : "linear");
+    writer->Key("width");
+    writer->Double(width);
+    writer->Key("offset");
+    writer->Int(offset);
+    writer->Key("counts");
+    write_counts(writer, counts);
+    writer->Key("zeros");
+    writer->Uint64(zeros);
+    writer->EndObject();
+}
+
+uint64_t histogram::min_int(size_t i) const
+{
+    int b = offset + int(i);
+    double edge = scale == LOG ? pow(10.0, b * width) : b * width;
+    uint64_t m = edge > 1 ? uint64_t(ceil(edge)) : 1;
+    // the edge is rounded, the bin of the integers around it is not
+    while ( m > 1 && bin(double(m - 1)) >= b ) {
+        m--;
+    }
+    while ( bin(double(m)) < b ) {
+        m++;
+    }
+    return m;
+}
+
+quantile_sketch::quantile_sketch(double a) : alpha(a), offset(0), zeros(0), n(0)
+{
+    gamma = (1 + alpha) / (1 - alpha);
+    log_gamma = ::log(gamma);
+}
+
+void quantile_sketch::add(double v, uint64_t c)
+{
+    n += c;
+    if ( v <= 0 ) {
+        zeros += c;
+        return;
+    }
+    add_count(counts, offset, int(ceil(::log(v) / log_gamma)), c);
+}
+
+void quantile_sketch::merge(const quantile_sketch& s)
+{
+    for ( size_t i = 0; i < s.counts.size(); i++ ) {
+        if ( s.counts[i] > 0 ) {
+            add_count(counts, offset, s.offset + int(i), s.counts[i]);
+        }
+    }
+    zeros += s.zeros;
+    n += s.n;
+}
+
+double quantile_sketch::quantile(double q) const
+{
+    if ( n == 0 ) {
+        return 0;
+    }
+    double rank = q * (n - 1);
+    uint64_t seen = zeros;
+    if ( rank < seen ) {
+        return 0;
+    }
+    for ( size_t i = 0; i < counts.size(); i++ ) {
+        seen += counts[i];
+        if ( rank < seen ) {
+            // middle of bucket (gamma^(k-1), gamma^k] in relative terms
+            return 2 * pow(gamma, offset + int(i)) / (gamma + 1);
+        }
+    }
+    return 2 * pow(gamma, offset + int(counts.size()) - 1) / (gamma + 1);
+}
+
+uint64_t quantile_sketch::count() const
+{
+    return n;
+}
+
+void quantile_sketch::write(json_writer* writer) const
+{
+    writer->StartObject();
+    writer->Key("alpha");
+    writer->Double(alpha);
+    writer->Key("offset");
+    writer->Int(offset);
+    writer->Key("counts");
+    write_counts(writer, counts);
+    writer->Key("zeros");
+    writer->Uint64(zeros);
+    writer->EndObject();
+}
+
+length_curve::length_curve(const histogram& h) : bases(h)
+{
+}
+
+void length_curve::add(uint64_t len)
+{
+    if ( len > 0 ) {
+        bases.add(double(len), len);
+    }
+}
+
+void length_curve::write(json_writer* writer) const
+{
+    writer->StartObject();
+    uint64_t total = 0;
+    char key[32];
+    for ( size_t i = bases.counts.size(); i-- > 0; ) {
+        if ( bases.counts[i] == 0 ) {
+            continue;
+        }
+        total += bases.counts[i];
+        snprintf(key, sizeof(key), "%llu", (unsigned long long)bases.min_int(i));
+        writer->Key(key);
+        writer->Uint64(total / 1000);
+    }
+    writer->EndObject();
+}
+
+distribution::distribution(const histogram& h) : hist(h), n(0), sum(0), min(0), max(0)
+{
+}
+
+void distribution::add(double v)
+{
+    if ( n == 0 || v < min ) {
+        min = v;
+    }
+    if ( n == 0 || v > max ) {
+        max = v;
+    }
+    n++;
+    sum += v;
+    hist.add(v);
+    sketch.add(v);
+}
+
+void distribution::merge(const distribution& d)
+{
+    if ( d.n == 0 ) {
+        return;
+    }
+    if ( n == 0 || d.min < min ) {
+        min = d.min;
+    }
+    if ( n == 0 || d.max > max ) {
+        max = d.max;
+    }
+    n += d.n;
+    sum += d.sum;
+    hist.merge(d.hist);
+    sketch.merge(d.sketch);
+}
+
+void distribution::write(json_writer* writer) const
+{
+    writer->StartObject();
+    writer->Key("count");
+    writer->Uint64(n);
+    writer->Key("sum");
+    writer->Double(sum);
+    writer->Key("min");
+    writer->Double(min);
+    writer->Key("max");
+    writer->Double(max);
+    writer->Key("histogram");
+    hist.write(writer);
+    writer->Key("sketch");
+    sketch.write(writer);
+    writer->EndObject();
+}
+
+distribution_writer::distribution_writer(json_writer* w, const char* k, const histogram& h, bool s)
+    : writer(w), key(k), summary(s), dist(h), values(NULL)
+{
+    if ( !summary ) {
+        writer->Key(key);
+        writer->StartArray();
+    }
+}
+
+void distribution_writer::add(double v)
+{
+    if ( values != NULL ) {
+        values->push_back(v);
+    }
+    if ( summary ) {
+        dist.add(v);
+    } else {
+        writer->Double(v);
+    }
+}
+
+void distribution_writer::add(int v)
+{
+    if ( summary ) {
+        dist.add(v);
+    } else {
+        writer->Int(v);
+    }
+}
+
+void distribution_writer::finish()
+{
+    if ( summary ) {
+        writer->Key(key);
+        dist.write(writer);
+    } else {
+        writer->EndArray();
+    }
+}
+
+void distribution_writer::tee(vector<double>* v)
+{
+    values = v;
+}
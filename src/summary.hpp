@@ -0,0 +1,120 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr summary -- histograms and quantile sketches used to
+// summarise distributions instead of writing every value
+//
+#ifndef SUMMARY_HPP
+#define SUMMARY_HPP
+
+#include <stdint.h>
+#include <vector>
+
+#include "json_writer.hpp"
+
+using namespace std;
+
+// counts of values in fixed-width bins, or in bins of fixed width
+// in log10 space; zeros are counted on their own
+class histogram
+{
+  public:
+    enum scale_t { LINEAR, LOG };
+    static histogram linear(double width);
+    static histogram log(unsigned int bins_per_decade);
+
+    void add(double v, uint64_t n = 1);
+    // histograms must have the same binning
+    void merge(const histogram& h);
+    void write(json_writer* writer) const;
+    // smallest whole number counted in counts[i]
+    uint64_t min_int(size_t i) const;
+
+    scale_t scale;
+    double width;           // bin width, in log10 units with LOG
+    int offset;             // index of the first bin in counts
+    vector<uint64_t> counts;
+    uint64_t zeros;
+
+  private:
+    histogram(scale_t s, double w);
+    int bin(double v) const;
+};
+
+// relative-accuracy quantile sketch: values are counted in buckets
+// growing by a factor gamma, so any quantile is returned within
+// alpha of its value; sketches with the same alpha can be merged
+class quantile_sketch
+{
+  public:
+    quantile_sketch(double alpha = 0.01);
+
+    void add(double v, uint64_t n = 1);
+    void merge(const quantile_sketch& s);
+    // value at quantile q, q in [0, 1]
+    double quantile(double q) const;
+    uint64_t count() const;
+    void write(json_writer* writer) const;
+
+  private:
+    double alpha, gamma, log_gamma;
+    int offset;
+    vector<uint64_t> counts;
+    uint64_t zeros;     // values <= 0
+    uint64_t n;
+};
+
+// histogram, quantile sketch and moments of a distribution
+class distribution
+{
+  public:
+    distribution(const histogram& h);
+
+    void add(double v);
+    void merge(const distribution& d);
+    void write(json_writer* writer) const;
+
+    histogram hist;
+    quantile_sketch sketch;
+    uint64_t n;
+    double sum, min, max;
+};
+
+// total bases of the reads at least as long as each bin's smallest
+// length: lengths are counted into the bins of h as they are added, the
+// totals are suffix sums over the bins taken when written
+class length_curve
+{
+  public:
+    length_curve(const histogram& h);
+
+    void add(uint64_t len);
+    // min read length -> total kilobases, longest first, for the bins with reads
+    void write(json_writer* writer) const;
+
+    histogram bases;    // bases of the reads of each bin
+};
+
+// writes a distribution to the preqclr file under key: with summary
+// set, as a distribution object, otherwise as an array of every value
+class distribution_writer
+{
+  public:
+    distribution_writer(json_writer* writer, const char* key, const histogram& h, bool summary);
+
+    void add(double v);
+    void add(int v);
+    void finish();
+    // values added as double are also appended to values
+    void tee(vector<double>* values);
+
+  private:
+    json_writer* writer;
+    const char* key;
+    bool summary;
+    distribution dist;
+    vector<double>* values;
+};
+
+#endif
@@ -0,0 +1,83 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr task_graph -- runs the stages of a run on a pool of threads,
+// each stage as soon as the stages it needs are done
+//
+#include "task_graph.hpp"
+#include <algorithm>
+
+using namespace std;
+
+task_graph::~task_graph()
+{
+    finish();
+}
+
+size_t task_graph::add(function<void()> f, const vector<size_t>& deps)
+{
+    size_t id = tasks.size();
+    task t;
+    t.f = f;
+    t.n_deps = deps.size();
+    t.started = t.done = false;
+    tasks.push_back(t);
+    for ( size_t d : deps ) {
+        tasks[d].dependents.push_back(id);
+    }
+    return id;
+}
+
+void task_graph::start(unsigned int n_threads)
+{
+    n_done = 0;
+    for ( unsigned int i = 0; i < max(n_threads, 1u); i++ ) {
+        threads.push_back(thread(&task_graph::work_loop, this));
+    }
+}
+
+void task_graph::wait(size_t id)
+{
+    unique_lock<mutex> lock(m);
+    cv.wait(lock, [&]{ return tasks[id].done; });
+}
+
+void task_graph::finish()
+{
+    for ( auto& t : threads ) {
+        t.join();
+    }
+    threads.clear();
+}
+
+void task_graph::work_loop()
+{
+    unique_lock<mutex> lock(m);
+    while ( true ) {
+        // the first task added of those ready
+        size_t id = tasks.size();
+        cv.wait(lock, [&]{
+            for ( id = 0; id < tasks.size(); id++ ) {
+                if ( !tasks[id].started && tasks[id].n_deps == 0 ) {
+                    return true;
+                }
+            }
+            return n_done == tasks.size();
+        });
+        if ( id == tasks.size() ) {
+            return;
+        }
+        task& t = tasks[id];
+        t.started = true;
+        lock.unlock();
+        t.f();
+        lock.lock();
+        t.done = true;
+        n_done++;
+        for ( size_t d : t.dependents ) {
+            tasks[d].n_deps--;
+        }
+        cv.notify_all();
+    }
+}
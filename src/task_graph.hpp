@@ -0,0 +1,53 @@
+//---------------------------------------------------------
+// Copyright 2018 Ontario Institute for Cancer Research
+//---------------------------------------------------------
+//
+// preqclr task_graph -- runs the stages of a run on a pool of threads,
+// each stage as soon as the stages it needs are done
+//
+#ifndef TASK_GRAPH_HPP
+#define TASK_GRAPH_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stddef.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+class task_graph
+{
+  public:
+    ~task_graph();
+
+    // the task runs once the tasks of deps are done; tasks are added
+    // before start, and ready tasks run in the order they were added
+    size_t add(function<void()> f, const vector<size_t>& deps);
+    // with a single thread, the tasks run one after another in the order added
+    void start(unsigned int n_threads);
+    // blocks until the task is done
+    void wait(size_t id);
+    // blocks until every task is done
+    void finish();
+
+  private:
+    struct task
+    {
+        function<void()> f;
+        vector<size_t> dependents;
+        size_t n_deps;      // tasks it needs not done yet
+        bool started, done;
+    };
+
+    mutex m;
+    condition_variable cv;
+    vector<task> tasks;
+    size_t n_done;
+    vector<thread> threads;
+
+    void work_loop();
+};
+
+#endif